@@ -0,0 +1,190 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+// 各个基准共用的计数器和测试方法。计数器在基准函数中构造，
+// 循环结束后调用 report：
+//   CacheMissCounter misses;
+//   LatencySampler latency;
+//   for (auto _ : state) {
+//     latency.measure([&] { ... });
+//   }
+//   misses.report(state);
+//   latency.report(state);
+
+// 当前线程在用户态的缓存未命中数，按所有线程的总迭代次数平均，
+// 报告为 cache_misses。需要 perf_event_open，
+// 在没有硬件计数器的环境（如多数虚拟机）或权限不足时不报告
+class CacheMissCounter {
+ public:
+  CacheMissCounter() {
+#if defined(__linux__)
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (fd_ >= 0) {
+      start_ = read_count();
+    }
+#endif
+  }
+
+  CacheMissCounter(const CacheMissCounter&) = delete;
+
+  CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+  ~CacheMissCounter() {
+#if defined(__linux__)
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif
+  }
+
+  void report(benchmark::State& state) {
+    if (fd_ < 0) {
+      return;
+    }
+    state.counters["cache_misses"] =
+        benchmark::Counter(static_cast<double>(read_count() - start_),
+                           benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  std::uint64_t read_count() const {
+    std::uint64_t res = 0;
+#if defined(__linux__)
+    if (read(fd_, &res, sizeof(res)) != sizeof(res)) {
+      res = 0;
+    }
+#endif
+    return res;
+  }
+
+ private:
+  int fd_ = -1;
+  std::uint64_t start_ = 0;
+};
+
+// 每 Interval 次操作计时一次，读时钟的开销分摊后不明显影响吞吐量。
+// 报告每个线程的 p50、p99、p999 延迟（纳秒）在所有线程上的平均值
+class LatencySampler {
+ public:
+  static constexpr std::size_t Interval = 64;
+
+  LatencySampler() { samples_.reserve(1 << 16); }
+
+  // 返回 f 的结果
+  template <typename F>
+  decltype(auto) measure(F&& f) {
+    if (++count_ % Interval != 0) {
+      return f();
+    }
+    const Stopwatch sw(samples_);
+    return f();
+  }
+
+  void report(benchmark::State& state) {
+    if (samples_.empty()) {
+      return;
+    }
+    std::sort(samples_.begin(), samples_.end());
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // 析构时记录构造以来的时间，f 返回 void 时也可以计时
+  class Stopwatch {
+   public:
+    explicit Stopwatch(std::vector<std::int64_t>& samples)
+        : samples_(samples), start_(Clock::now()) {}
+
+    ~Stopwatch() {
+      samples_.push_back(static_cast<std::int64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                               start_)
+              .count()));
+    }
+
+   private:
+    std::vector<std::int64_t>& samples_;
+    const Clock::time_point start_;
+  };
+
+  benchmark::Counter percentile(double p) const {
+    const auto i = static_cast<std::size_t>(p * (samples_.size() - 1));
+    return benchmark::Counter(static_cast<double>(samples_[i]),
+                              benchmark::Counter::kAvgThreads);
+  }
+
+ private:
+  std::vector<std::int64_t> samples_;
+  std::size_t count_ = 0;
+};
+
+// 按 state.range(0) 给出的百分比把线程分为生产者和消费者，各至少一个，
+// 因此至少需要两个线程。push 放入一个元素，pop 成功取出时返回 true。
+// backlog 记录尚未取出的元素数，由同一基准的所有线程共享，
+// 超过 MaxBacklog 时生产者让出 CPU，容器不会在生产者更多时无限增长，
+// 消费者取不到元素时同样让出 CPU。
+// 报告成功的 push 和 pop 总数（items_per_second）、延迟和缓存未命中
+template <typename Push, typename Pop>
+void run_producer_consumer(benchmark::State& state,
+                           std::atomic<std::int64_t>& backlog, Push push,
+                           Pop pop) {
+  constexpr std::int64_t MaxBacklog = 1024;
+  const std::int64_t threads = state.threads();
+  const std::int64_t producers =
+      std::clamp<std::int64_t>(threads * state.range(0) / 100, 1, threads - 1);
+  const bool producer = state.thread_index() < producers;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  std::int64_t done = 0;
+  for (auto _ : state) {
+    if (producer) {
+      if (backlog.load(std::memory_order_relaxed) >= MaxBacklog) {
+        std::this_thread::yield();
+        continue;
+      }
+      latency.measure(push);
+      backlog.fetch_add(1, std::memory_order_relaxed);
+      ++done;
+    } else if (latency.measure(pop)) {
+      backlog.fetch_sub(1, std::memory_order_relaxed);
+      ++done;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed(done);
+  state.counters["producers"] =
+      benchmark::Counter(static_cast<double>(producers),
+                         benchmark::Counter::kAvgThreads);
+  misses.report(state);
+  latency.report(state);
+}
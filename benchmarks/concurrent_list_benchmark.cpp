@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "benchmark_support.hpp"
+#include "concurrent_list.hpp"
+#include "lazy_concurrent_list.hpp"
+#include "lock_free_list.hpp"
+
+// 比较逐节点加锁的 ConcurrentList 与不加锁遍历的 LazyConcurrentList、
+// LockFreeList，每次查找都遍历整个链表
+
+namespace {
+
+using Value = std::uint64_t;
+using HandOverHandList = ConcurrentList<Value>;
+using LazyList = LazyConcurrentList<Value>;
+using HarrisList = LockFreeList<Value>;
+
+constexpr Value NodeCount = 10000;
+
+template <typename List>
+List& filled_list() {
+  static List* l = [] {
+    auto res = new List;
+    for (Value i = 0; i < NodeCount; ++i) {
+      res->push_front(i);
+    }
+    return res;
+  }();
+  return *l;
+}
+
+// 查找不存在的元素
+template <typename List>
+void BM_Scan(benchmark::State& state) {
+  List& l = filled_list<List>();
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      benchmark::DoNotOptimize(
+          l.find_first_if([](const Value& x) { return x == NodeCount; }));
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * NodeCount);
+  misses.report(state);
+  latency.report(state);
+}
+
+// 每轮插入一个元素再删除它，与其他线程的遍历并发
+template <typename List>
+void BM_ScanWithWriters(benchmark::State& state) {
+  List& l = filled_list<List>();
+  const Value key = NodeCount + 1 + state.thread_index();
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      l.push_front(key);
+      l.remove_if([&](const Value& x) { return x == key; });
+    } else {
+      benchmark::DoNotOptimize(
+          l.find_first_if([](const Value& x) { return x == NodeCount; }));
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_Scan, HandOverHandList)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Scan, LazyList)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Scan, HarrisList)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ScanWithWriters, HandOverHandList)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ScanWithWriters, LazyList)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ScanWithWriters, HarrisList)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+
+#include "benchmark_support.hpp"
+#include "concurrent_map.hpp"
+#include "flat_bucket.hpp"
+
+// 比较 ListBucket 与 FlatBucket 两种桶布局
+
+namespace {
+
+using Key = std::uint64_t;
+using Value = std::uint64_t;
+using ListMap = ConcurrentMap<Key, Value>;
+using FlatMap =
+    ConcurrentMap<Key, Value, std::hash<Key>, FlatBucket<Key, Value>>;
+
+constexpr Key KeyCount = 1 << 20;
+
+// 所有线程共享同一个预先填充的表
+template <typename Map>
+Map& filled_map() {
+  static Map* m = [] {
+    auto res = new Map;
+    for (Key i = 0; i < KeyCount; ++i) {
+      res->set(i, i);
+    }
+    return res;
+  }();
+  return *m;
+}
+
+template <typename Map>
+void BM_Get(benchmark::State& state) {
+  Map& m = filled_map<Map>();
+  std::minstd_rand rng(state.thread_index() + 1);
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      benchmark::DoNotOptimize(m.get(rng() % KeyCount));
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+// 一半命中已有元素，一半查找不存在的键
+template <typename Map>
+void BM_GetMiss(benchmark::State& state) {
+  Map& m = filled_map<Map>();
+  std::minstd_rand rng(state.thread_index() + 1);
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      benchmark::DoNotOptimize(m.get(rng() % (KeyCount * 2)));
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+// 读写比为 99:1
+template <typename Map>
+void BM_ReadMostly(benchmark::State& state) {
+  Map& m = filled_map<Map>();
+  std::minstd_rand rng(state.thread_index() + 1);
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    const Key k = rng() % KeyCount;
+    latency.measure([&] {
+      if (k % 100 == 0) {
+        m.set(k, k);
+      } else {
+        benchmark::DoNotOptimize(m.get(k));
+      }
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+// 从空表开始插入，包含扩容和迁移的开销
+template <typename Map>
+void BM_Insert(benchmark::State& state) {
+  const auto n = static_cast<Key>(state.range(0));
+  for (auto _ : state) {
+    Map m;
+    for (Key i = 0; i < n; ++i) {
+      m.set(i, i);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_Get, ListMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Get, FlatMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_GetMiss, ListMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_GetMiss, FlatMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReadMostly, ListMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReadMostly, FlatMap)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Insert, ListMap)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_Insert, FlatMap)->Range(1 << 10, 1 << 18);
+
+BENCHMARK_MAIN();
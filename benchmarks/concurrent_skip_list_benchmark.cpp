@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+
+#include "benchmark_support.hpp"
+#include "concurrent_map.hpp"
+#include "concurrent_skip_list.hpp"
+
+// ConcurrentSkipList 的点查询与 ConcurrentMap 比较，
+// 区间遍历与用 std::shared_mutex 保护的 std::map 比较。
+// BM_ScanWithWrites 中一个线程不断插入和删除，其余线程遍历，
+// 加锁的 std::map 在写者持锁期间阻塞所有读者
+
+namespace {
+
+using Key = std::uint64_t;
+using Value = std::uint64_t;
+
+constexpr Key KeyCount = 1 << 18;
+constexpr Key ScanLength = 64;
+
+// 偶数键预先插入，写者只插入和删除奇数键
+ConcurrentSkipList<Key, Value>& filled_skip_list() {
+  static auto* s = [] {
+    auto res = new ConcurrentSkipList<Key, Value>;
+    for (Key i = 0; i < KeyCount; i += 2) {
+      res->insert(i, i);
+    }
+    return res;
+  }();
+  return *s;
+}
+
+ConcurrentMap<Key, Value>& filled_map() {
+  static auto* m = [] {
+    auto res = new ConcurrentMap<Key, Value>;
+    for (Key i = 0; i < KeyCount; i += 2) {
+      res->set(i, i);
+    }
+    return res;
+  }();
+  return *m;
+}
+
+struct LockedMap {
+  std::shared_mutex m;
+  std::map<Key, Value> map;
+};
+
+LockedMap& filled_locked_map() {
+  static auto* m = [] {
+    auto res = new LockedMap;
+    for (Key i = 0; i < KeyCount; i += 2) {
+      res->map.emplace(i, i);
+    }
+    return res;
+  }();
+  return *m;
+}
+
+void BM_SkipListGet(benchmark::State& state) {
+  auto& s = filled_skip_list();
+  std::minstd_rand rng(state.thread_index() + 1);
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] { benchmark::DoNotOptimize(s.get(rng() % KeyCount)); });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+void BM_MapGet(benchmark::State& state) {
+  auto& m = filled_map();
+  std::minstd_rand rng(state.thread_index() + 1);
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] { benchmark::DoNotOptimize(m.get(rng() % KeyCount)); });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+void BM_SkipListInsertErase(benchmark::State& state) {
+  auto& s = filled_skip_list();
+  std::minstd_rand rng(state.thread_index() + 1);
+  LatencySampler latency;
+  for (auto _ : state) {
+    const Key k = rng() % KeyCount | 1;
+    latency.measure([&] {
+      s.insert(k, k);
+      s.erase(k);
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  latency.report(state);
+}
+
+// 线程 0 为写者，其余线程每次从随机位置遍历 ScanLength 个键
+void BM_SkipListScanWithWrites(benchmark::State& state) {
+  auto& s = filled_skip_list();
+  std::minstd_rand rng(state.thread_index() + 1);
+  LatencySampler latency;
+  for (auto _ : state) {
+    const Key k = rng() % KeyCount;
+    if (state.thread_index() == 0) {
+      s.insert(k | 1, k);
+      s.erase(k | 1);
+      continue;
+    }
+    latency.measure([&] {
+      Value sum = 0;
+      s.for_each_in_range(k, k + ScanLength,
+                          [&](const Key&, const Value& v) { sum += v; });
+      benchmark::DoNotOptimize(sum);
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+  latency.report(state);
+}
+
+void BM_LockedMapScanWithWrites(benchmark::State& state) {
+  auto& m = filled_locked_map();
+  std::minstd_rand rng(state.thread_index() + 1);
+  LatencySampler latency;
+  for (auto _ : state) {
+    const Key k = rng() % KeyCount;
+    if (state.thread_index() == 0) {
+      std::lock_guard<std::shared_mutex> l(m.m);
+      m.map.emplace(k | 1, k);
+      m.map.erase(k | 1);
+      continue;
+    }
+    latency.measure([&] {
+      Value sum = 0;
+      std::shared_lock<std::shared_mutex> l(m.m);
+      for (auto it = m.map.lower_bound(k);
+           it != m.map.end() && it->first < k + ScanLength; ++it) {
+        sum += it->second;
+      }
+      benchmark::DoNotOptimize(sum);
+    });
+  }
+  state.SetItemsProcessed(state.iterations());
+  latency.report(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_SkipListGet)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_MapGet)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_SkipListInsertErase)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_SkipListScanWithWrites)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK(BM_LockedMapScanWithWrites)->ThreadRange(2, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark_support.hpp"
+#include "concurrent_stack.hpp"
+#include "lock_policy.hpp"
+
+// 基于锁的 ConcurrentStack，锁被占用时先尝试消除数组，
+// 比较默认的 std::mutex 与 AdaptiveMutex。
+// 无锁栈见 lock_free_stack_benchmark.cpp
+
+namespace {
+
+struct Item {
+  std::uint64_t v;
+};
+
+using MutexStack = ConcurrentStack<Item>;
+using AdaptiveStack = ConcurrentStack<Item, AdaptiveMutex<>>;
+
+template <typename Stack>
+Stack& shared_stack() {
+  static Stack s;
+  return s;
+}
+
+// 每个线程交替 push 和 try_pop，成对的操作可以在消除数组中配对
+template <typename Stack>
+void BM_PushPop(benchmark::State& state) {
+  Stack& s = shared_stack<Stack>();
+  std::uint64_t i = 0;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      s.push(Item{i++});
+      benchmark::DoNotOptimize(s.try_pop());
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  misses.report(state);
+  latency.report(state);
+}
+
+template <typename Stack>
+void BM_ProducerConsumer(benchmark::State& state) {
+  static Stack s;
+  static std::atomic<std::int64_t> backlog = 0;
+  std::uint64_t i = 0;
+  run_producer_consumer(
+      state, backlog, [&] { s.push(Item{i++}); },
+      [&] { return s.try_pop().has_value(); });
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_PushPop, MutexStack)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, AdaptiveStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, MutexStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, AdaptiveStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
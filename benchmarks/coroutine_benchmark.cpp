@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "coroutine.hpp"
+
+// 需要 C++20，CMake 只为此程序开启。
+// BM_Schedule 为 co_await pool.schedule() 的开销，与 thread_pool_benchmark.cpp
+// 中的 BM_PostBatch 对应。BM_AsyncMutex 中 Batch 个协程竞争同一个锁，
+// 等待者挂起而不占用线程。BM_AsyncQueue 由基准线程 push，
+// Batch 个协程 co_await pop，每次 push 都直接交给一个挂起的消费者
+
+namespace {
+
+constexpr std::size_t Batch = 64;
+
+ThreadPool& shared_pool() {
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+Task<> wait(AsyncLatch<>& latch) { co_await latch.wait(); }
+
+Task<> schedule_once(ThreadPool& pool, AsyncLatch<>& done) {
+  co_await pool.schedule();
+  done.count_down();
+}
+
+void BM_Schedule(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  for (auto _ : state) {
+    AsyncLatch<> done(pool, Batch);
+    for (std::size_t i = 0; i < Batch; ++i) {
+      spawn(schedule_once(pool, done));
+    }
+    sync_wait(wait(done));
+  }
+  state.SetItemsProcessed(state.iterations() * Batch);
+}
+
+Task<> lock_loop(AsyncMutex<>& m, std::int64_t n, std::uint64_t& counter,
+                 AsyncLatch<>& done) {
+  co_await shared_pool().schedule();
+  for (std::int64_t i = 0; i < n; ++i) {
+    auto l = co_await m.scoped_lock();
+    ++counter;
+  }
+  done.count_down();
+}
+
+void BM_AsyncMutex(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  AsyncMutex<> m(pool);
+  std::uint64_t counter = 0;
+  for (auto _ : state) {
+    AsyncLatch<> done(pool, Batch);
+    for (std::size_t i = 0; i < Batch; ++i) {
+      spawn(lock_loop(m, state.range(0), counter, done));
+    }
+    sync_wait(wait(done));
+  }
+  benchmark::DoNotOptimize(counter);
+  state.SetItemsProcessed(state.iterations() * Batch * state.range(0));
+}
+
+Task<> consume(AsyncQueue<std::uint64_t>& q, AsyncLatch<>& done) {
+  benchmark::DoNotOptimize(co_await q.pop());
+  done.count_down();
+}
+
+void BM_AsyncQueue(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  AsyncQueue<std::uint64_t> q(pool);
+  for (auto _ : state) {
+    AsyncLatch<> done(pool, Batch);
+    for (std::size_t i = 0; i < Batch; ++i) {
+      spawn(consume(q, done));
+    }
+    for (std::uint64_t i = 0; i < Batch; ++i) {
+      q.push(i);
+    }
+    sync_wait(wait(done));
+  }
+  state.SetItemsProcessed(state.iterations() * Batch);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Schedule)->UseRealTime();
+BENCHMARK(BM_AsyncMutex)->Arg(1)->Arg(16)->UseRealTime();
+BENCHMARK(BM_AsyncQueue)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "benchmark_support.hpp"
+#include "concurrent_queue.hpp"
+#include "lock_free_queue.hpp"
+#include "node_pool.hpp"
+
+// 比较双锁的 ConcurrentQueue 与无锁的 LockFreeQueue，
+// 每个线程交替 push 和 try_pop，队列长度保持在线程数附近。
+// BM_ProducerConsumer 按参数给出的生产者百分比分配线程
+
+namespace {
+
+struct Item {
+  std::uint64_t v;
+};
+
+using LockedQueue = ConcurrentQueue<Item>;
+using LockedPoolQueue = ConcurrentQueue<Item, PoolAllocator<Item>>;
+using HazardPointerQueue = LockFreeQueue<Item>;
+using HazardPointerPoolQueue = LockFreeQueue<Item, PoolAllocator<Item>>;
+using EpochQueue = LockFreeQueue<Item, std::allocator<Item>, EpochReclaimer>;
+using EpochPoolQueue =
+    LockFreeQueue<Item, PoolAllocator<Item>, EpochReclaimer>;
+
+template <typename Queue>
+Queue& shared_queue() {
+  static Queue q;
+  return q;
+}
+
+template <typename Queue>
+void BM_PushPop(benchmark::State& state) {
+  Queue& q = shared_queue<Queue>();
+  std::uint64_t i = 0;
+  Item x;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      q.push(Item{i++});
+      benchmark::DoNotOptimize(q.try_pop(x));
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  misses.report(state);
+  latency.report(state);
+}
+
+template <typename Queue>
+void BM_ProducerConsumer(benchmark::State& state) {
+  static Queue q;
+  static std::atomic<std::int64_t> backlog = 0;
+  std::uint64_t i = 0;
+  Item x;
+  run_producer_consumer(
+      state, backlog, [&] { q.push(Item{i++}); }, [&] { return q.try_pop(x); });
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_PushPop, LockedQueue)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, LockedPoolQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, HazardPointerQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, HazardPointerPoolQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, EpochQueue)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, EpochPoolQueue)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, LockedQueue)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, LockedPoolQueue)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, HazardPointerQueue)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, EpochQueue)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark_support.hpp"
+#include "lock_free_stack.hpp"
+#include "node_pool.hpp"
+#include "tagged_lock_free_stack.hpp"
+
+// 比较引用计数版本的 LockFreeStack（默认分配器和 PoolAllocator）与
+// TaggedLockFreeStack，风险指针版本与前者同名，见
+// lock_free_stack_hazard_pointer_benchmark.cpp
+
+namespace {
+
+// 放在匿名命名空间中，与其他翻译单元中同名容器的实例化互不冲突
+struct Item {
+  std::uint64_t v;
+};
+
+using RefCountStack = LockFreeStack<Item>;
+using RefCountPoolStack = LockFreeStack<Item, PoolAllocator<Item>>;
+using TaggedStack = TaggedLockFreeStack<Item>;
+
+template <typename Stack>
+Stack& shared_stack() {
+  static Stack s;
+  return s;
+}
+
+// 每个线程交替 push 和 pop，栈保持接近为空，竞争集中在栈顶
+template <typename Stack>
+void BM_PushPop(benchmark::State& state) {
+  Stack& s = shared_stack<Stack>();
+  std::uint64_t i = 0;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      s.push(Item{i++});
+      benchmark::DoNotOptimize(s.pop());
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  misses.report(state);
+  latency.report(state);
+}
+
+// 生产者只 push，消费者只 pop，比例见 run_producer_consumer
+template <typename Stack>
+void BM_ProducerConsumer(benchmark::State& state) {
+  static Stack s;
+  static std::atomic<std::int64_t> backlog = 0;
+  std::uint64_t i = 0;
+  run_producer_consumer(
+      state, backlog, [&] { s.push(Item{i++}); },
+      [&] { return s.pop() != nullptr; });
+}
+
+// TaggedLockFreeStack 弹出到已有对象，不为结果分配内存
+void BM_TaggedPushPopInPlace(benchmark::State& state) {
+  TaggedStack& s = shared_stack<TaggedStack>();
+  std::uint64_t i = 0;
+  Item res{};
+  for (auto _ : state) {
+    s.push(Item{i++});
+    benchmark::DoNotOptimize(s.pop(res));
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+// 先压入一批再全部弹出，栈中元素较多
+template <typename Stack>
+void BM_Burst(benchmark::State& state) {
+  Stack& s = shared_stack<Stack>();
+  const auto n = static_cast<std::uint64_t>(state.range(0));
+  for (auto _ : state) {
+    for (std::uint64_t i = 0; i < n; ++i) {
+      s.push(Item{i});
+    }
+    for (std::uint64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(s.pop());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_PushPop, RefCountStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, RefCountPoolStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, TaggedStack)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_TaggedPushPopInPlace)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Burst, RefCountStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_Burst, RefCountPoolStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_Burst, TaggedStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, RefCountStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, RefCountPoolStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, TaggedStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "benchmark_support.hpp"
+#include "lock_free_stack_hazard_pointer.hpp"
+#include "node_pool.hpp"
+
+// 风险指针版本的 LockFreeStack，与 lock_free_stack 中的版本同名，
+// 因此单独放在一个翻译单元中，测试方法与 lock_free_stack_benchmark.cpp 相同。
+// 同时比较风险指针与 EBR 两种回收器
+
+namespace {
+
+// 放在匿名命名空间中，与其他翻译单元中同名容器的实例化互不冲突
+struct Item {
+  std::uint64_t v;
+};
+
+using HazardPointerStack = LockFreeStack<Item>;
+using HazardPointerPoolStack = LockFreeStack<Item, PoolAllocator<Item>>;
+using EpochStack = LockFreeStack<Item, std::allocator<Item>, EpochReclaimer>;
+using EpochPoolStack =
+    LockFreeStack<Item, PoolAllocator<Item>, EpochReclaimer>;
+
+template <typename Stack>
+Stack& shared_stack() {
+  static Stack s;
+  return s;
+}
+
+template <typename Stack>
+void BM_PushPop(benchmark::State& state) {
+  Stack& s = shared_stack<Stack>();
+  std::uint64_t i = 0;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      s.push(Item{i++});
+      benchmark::DoNotOptimize(s.pop());
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  misses.report(state);
+  latency.report(state);
+}
+
+// 生产者只 push，消费者只 pop，比例见 run_producer_consumer
+template <typename Stack>
+void BM_ProducerConsumer(benchmark::State& state) {
+  static Stack s;
+  static std::atomic<std::int64_t> backlog = 0;
+  std::uint64_t i = 0;
+  run_producer_consumer(
+      state, backlog, [&] { s.push(Item{i++}); },
+      [&] { return s.pop() != nullptr; });
+}
+
+template <typename Stack>
+void BM_Burst(benchmark::State& state) {
+  Stack& s = shared_stack<Stack>();
+  const auto n = static_cast<std::uint64_t>(state.range(0));
+  for (auto _ : state) {
+    for (std::uint64_t i = 0; i < n; ++i) {
+      s.push(Item{i});
+    }
+    for (std::uint64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(s.pop());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_PushPop, HazardPointerStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, HazardPointerPoolStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, EpochStack)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, EpochPoolStack)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Burst, HazardPointerStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_Burst, HazardPointerPoolStack)
+    ->Arg(1024)
+    ->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_Burst, EpochStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_Burst, EpochPoolStack)->Arg(1024)->ThreadRange(1, 4);
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, HazardPointerStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, EpochStack)
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(75)
+    ->ThreadRange(2, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+
+#include "concurrent_queue.hpp"
+#include "lock_policy.hpp"
+
+// 比较 std::mutex 与 lock_policy.hpp 中的锁：BM_Lock 保护一次计数器自增，
+// BM_QueuePushPop 把锁用于 ConcurrentQueue。带计数的版本报告等待的比例
+// 和平均等待时间，可以看出计数本身的开销
+
+namespace {
+
+struct TtasTag;
+struct AdaptiveTag;
+struct McsTag;
+
+using Ttas = TtasSpinLock<>;
+using Adaptive = AdaptiveMutex<>;
+using Mcs = McsLock<>;
+using CountedTtas = TtasSpinLock<LockCounters<TtasTag>>;
+using CountedAdaptive = AdaptiveMutex<LockCounters<AdaptiveTag>>;
+using CountedMcs = McsLock<LockCounters<McsTag>>;
+
+template <typename Lock>
+struct CountersOf {
+  static void reset() {}
+
+  static void report(benchmark::State&) {}
+};
+
+template <template <typename> class Lock, typename Tag>
+struct CountersOf<Lock<LockCounters<Tag>>> {
+  static void reset() { LockCounters<Tag>::reset(); }
+
+  static void report(benchmark::State& state) {
+    const LockStats s = LockCounters<Tag>::stats();
+    if (s.acquisitions == 0) {
+      return;
+    }
+    state.counters["contended"] =
+        static_cast<double>(s.contended) / s.acquisitions;
+    state.counters["wait_ns"] =
+        s.contended ? static_cast<double>(s.wait_time.count()) / s.contended
+                    : 0.0;
+  }
+};
+
+template <typename Lock>
+void BM_Lock(benchmark::State& state) {
+  static Lock m;
+  static std::uint64_t counter = 0;
+  if (state.thread_index() == 0) {
+    CountersOf<Lock>::reset();
+  }
+  for (auto _ : state) {
+    std::lock_guard<Lock> l(m);
+    benchmark::DoNotOptimize(++counter);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    CountersOf<Lock>::report(state);
+  }
+}
+
+template <typename Lock>
+void BM_QueuePushPop(benchmark::State& state) {
+  static ConcurrentQueue<std::uint64_t, std::allocator<std::uint64_t>, Lock> q;
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    q.push(i++);
+    benchmark::DoNotOptimize(q.try_pop());
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_Lock, std::mutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, Ttas)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, Adaptive)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, Mcs)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, CountedTtas)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, CountedAdaptive)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lock, CountedMcs)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueuePushPop, std::mutex)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueuePushPop, Ttas)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueuePushPop, Adaptive)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueuePushPop, Mcs)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
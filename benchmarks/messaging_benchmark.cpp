@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "messaging.hpp"
+
+// 同一线程发送并调度消息，测量每条消息入队、出队和分派的开销。
+// 处理链上有四种消息，目标消息位于链的最前端，需要比较全部四个类型
+
+namespace {
+
+struct Ping {
+  std::uint64_t v;
+};
+
+struct Text {
+  std::string s;
+};
+
+struct Other1 {};
+
+struct Other2 {};
+
+struct Other3 {};
+
+template <typename Msg>
+void BM_SendDispatch(benchmark::State& state, Msg msg) {
+  Messaging::Receiver r;
+  Messaging::Sender s = r;
+  std::uint64_t handled = 0;
+  for (auto _ : state) {
+    s.send(msg);
+    r.wait()
+        .template handle<Msg>([&](const Msg&) { ++handled; })
+        .template handle<Other1>([&](const Other1&) {})
+        .template handle<Other2>([&](const Other2&) {})
+        .template handle<Other3>([&](const Other3&) {});
+  }
+  benchmark::DoNotOptimize(handled);
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_SendDispatch, small, Ping{1});
+BENCHMARK_CAPTURE(BM_SendDispatch, string, Text{"short"});
+
+BENCHMARK_MAIN();
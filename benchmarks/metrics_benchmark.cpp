@@ -0,0 +1,63 @@
+// 测量开启时指标本身的开销，与未开启指标的其他程序分别编译
+#if !defined(CONCURRENCY_METRICS)
+#define CONCURRENCY_METRICS 1
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mutex>
+
+#include "metrics.hpp"
+
+// BM_CounterAdd 与 BM_HistogramRecord 为记录一次的开销，
+// 线程数不超过分片数时各线程写不同的缓存行。
+// BM_MeteredLock 与 BM_PlainLock 比较无竞争时 MeteredLockGuard 多出的开销
+
+namespace {
+
+void BM_CounterAdd(benchmark::State& state) {
+  static ShardedCounter c("benchmark_counter_total");
+  for (auto _ : state) {
+    c.add();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_HistogramRecord(benchmark::State& state) {
+  static Histogram h("benchmark_histogram");
+  std::uint64_t v = 0;
+  for (auto _ : state) {
+    h.record(v++ & 0xffff);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// 每个线程使用自己的锁，只测量加锁本身
+void BM_PlainLock(benchmark::State& state) {
+  std::mutex m;
+  for (auto _ : state) {
+    std::lock_guard<std::mutex> l(m);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_MeteredLock(benchmark::State& state) {
+  static LockMetrics metrics("benchmark_lock");
+  std::mutex m;
+  for (auto _ : state) {
+    MeteredLockGuard<std::mutex> l(m, metrics);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_CounterAdd)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_HistogramRecord)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_PlainLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_MeteredLock)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parallel_algorithm.hpp"
+#include "thread_poll.hpp"
+
+// 比较 parallel_algorithm.hpp 与对应的标准库算法。
+// 第一个参数为元素个数，第二个参数为工作线程数，调用者另外参与执行，
+// 0 个工作线程时只有划分与合并的开销。BM_Std* 为单线程的基准
+
+namespace {
+
+std::vector<std::uint32_t> random_input(std::size_t n) {
+  std::vector<std::uint32_t> v(n);
+  std::mt19937 rng(42);
+  for (std::uint32_t& x : v) {
+    x = rng();
+  }
+  return v;
+}
+
+void parallel_args(benchmark::internal::Benchmark* b) {
+  for (std::int64_t n : {1 << 16, 1 << 20, 1 << 24}) {
+    for (std::int64_t workers : {0, 1, 3, 7}) {
+      b->Args({n, workers});
+    }
+  }
+}
+
+void BM_StdReduce(benchmark::State& state) {
+  const auto v = random_input(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        std::accumulate(v.begin(), v.end(), std::uint64_t{0}));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ParallelReduce(benchmark::State& state) {
+  ThreadPool pool(state.range(1));
+  const auto v = random_input(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        parallel_reduce(pool, v.begin(), v.end(), std::uint64_t{0}));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_StdPartialSum(benchmark::State& state) {
+  const auto v = random_input(state.range(0));
+  std::vector<std::uint32_t> out(v.size());
+  for (auto _ : state) {
+    std::partial_sum(v.begin(), v.end(), out.begin());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ParallelPartialSum(benchmark::State& state) {
+  ThreadPool pool(state.range(1));
+  const auto v = random_input(state.range(0));
+  std::vector<std::uint32_t> out(v.size());
+  for (auto _ : state) {
+    parallel_partial_sum(pool, v.begin(), v.end(), out.begin());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// 元素为 std::string，op 需要真正复制和移动元素，拼接的长度随下标增长，
+// 因此只用较小的 n。拼接不满足交换律，元素各不相同，
+// 开始前与 std::partial_sum 的结果比较，可以发现改变了运算顺序的实现
+void BM_ParallelPartialSumString(benchmark::State& state) {
+  constexpr std::size_t Grain = 64;
+  ThreadPool pool(state.range(1));
+  std::vector<std::string> v(state.range(0));
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    v[i] = std::string(1, static_cast<char>('a' + i % 26));
+  }
+  std::vector<std::string> expected(v.size());
+  std::vector<std::string> out(v.size());
+  std::partial_sum(v.begin(), v.end(), expected.begin());
+  parallel_partial_sum(pool, v.begin(), v.end(), out.begin(), std::plus<>(),
+                       Grain);
+  if (out != expected) {
+    state.SkipWithError("parallel_partial_sum differs from std::partial_sum");
+    return;
+  }
+  for (auto _ : state) {
+    parallel_partial_sum(pool, v.begin(), v.end(), out.begin(),
+                         std::plus<>(), Grain);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// 要找的元素在正中间，并行版本在找到后跳过后半部分的块
+void BM_ParallelFind(benchmark::State& state) {
+  ThreadPool pool(state.range(1));
+  std::vector<std::uint32_t> v(state.range(0));
+  v[v.size() / 2] = 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parallel_find(pool, v.begin(), v.end(), 1u));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) / 2);
+}
+
+// 每次迭代排序一份新的副本，复制不计时
+void BM_StdSort(benchmark::State& state) {
+  const auto input = random_input(state.range(0));
+  std::vector<std::uint32_t> v;
+  for (auto _ : state) {
+    state.PauseTiming();
+    v = input;
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ParallelSort(benchmark::State& state) {
+  ThreadPool pool(state.range(1));
+  const auto input = random_input(state.range(0));
+  std::vector<std::uint32_t> v;
+  for (auto _ : state) {
+    state.PauseTiming();
+    v = input;
+    state.ResumeTiming();
+    parallel_sort(pool, v.begin(), v.end());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_StdReduce)->RangeMultiplier(16)->Range(1 << 16, 1 << 24);
+BENCHMARK(BM_ParallelReduce)->Apply(parallel_args)->UseRealTime();
+BENCHMARK(BM_StdPartialSum)->RangeMultiplier(16)->Range(1 << 16, 1 << 24);
+BENCHMARK(BM_ParallelPartialSum)->Apply(parallel_args)->UseRealTime();
+BENCHMARK(BM_ParallelPartialSumString)
+    ->ArgsProduct({{1 << 12}, {0, 1, 3, 7}})
+    ->UseRealTime();
+BENCHMARK(BM_ParallelFind)->Apply(parallel_args)->UseRealTime();
+BENCHMARK(BM_StdSort)->RangeMultiplier(16)->Range(1 << 16, 1 << 24);
+BENCHMARK(BM_ParallelSort)->Apply(parallel_args)->UseRealTime();
+
+BENCHMARK_MAIN();
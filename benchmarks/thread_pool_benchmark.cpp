@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "benchmark_support.hpp"
+#include "thread_poll.hpp"
+
+// 测量 ThreadPool 调度短任务的开销。基准线程都在池外，
+// BM_SubmitGet 测量提交到取得结果的往返延迟，
+// BM_PostBatch 从池外批量提交，任务经过全局通道，
+// BM_NestedPost 由池内的任务提交子任务，子任务进入工作线程的本地队列并被窃取。
+// 缓存未命中只统计基准线程，不含工作线程
+
+namespace {
+
+constexpr std::size_t Batch = 64;
+
+ThreadPool& shared_pool() {
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+// 等待期间执行队列中的任务，不占着 CPU 空转
+void wait_for(ThreadPool& pool, const std::atomic<std::size_t>& remaining) {
+  while (remaining.load(std::memory_order_acquire) != 0) {
+    pool.run_pending_task();
+  }
+}
+
+void BM_SubmitGet(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure(
+        [&] { benchmark::DoNotOptimize(pool.submit([] { return 1; }).get()); });
+  }
+  state.SetItemsProcessed(state.iterations());
+  misses.report(state);
+  latency.report(state);
+}
+
+void BM_PostBatch(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  std::atomic<std::size_t> remaining = 0;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      remaining.store(Batch, std::memory_order_relaxed);
+      for (std::size_t i = 0; i < Batch; ++i) {
+        pool.post(
+            [&] { remaining.fetch_sub(1, std::memory_order_release); });
+      }
+      wait_for(pool, remaining);
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * Batch);
+  misses.report(state);
+  latency.report(state);
+}
+
+void BM_NestedPost(benchmark::State& state) {
+  ThreadPool& pool = shared_pool();
+  std::atomic<std::size_t> remaining = 0;
+  CacheMissCounter misses;
+  LatencySampler latency;
+  for (auto _ : state) {
+    latency.measure([&] {
+      remaining.store(Batch, std::memory_order_relaxed);
+      pool.post([&] {
+        for (std::size_t i = 0; i < Batch; ++i) {
+          pool.post(
+              [&] { remaining.fetch_sub(1, std::memory_order_release); });
+        }
+      });
+      wait_for(pool, remaining);
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * Batch);
+  misses.report(state);
+  latency.report(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_SubmitGet)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_PostBatch)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_NestedPost)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+// 已有 state.range(0) 个未到期的定时器时，调度并取消一个定时器的开销，
+// 与已有定时器的数量无关
+
+namespace {
+
+void noop(void*) noexcept {}
+
+void BM_ScheduleCancel(benchmark::State& state) {
+  TimerWheel wheel;
+  const auto now = TimerWheel::Clock::now();
+  std::vector<std::unique_ptr<TimerWheel::Timer>> background;
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    auto t = std::make_unique<TimerWheel::Timer>(&noop, nullptr);
+    wheel.schedule(*t, now + std::chrono::seconds(60 + i % 600));
+    background.emplace_back(std::move(t));
+  }
+  TimerWheel::Timer t(&noop, nullptr);
+  std::int64_t i = 0;
+  for (auto _ : state) {
+    wheel.schedule(t, now + std::chrono::milliseconds(10 + i++ % 5000));
+    benchmark::DoNotOptimize(wheel.cancel(t));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_ScheduleCancel)->Arg(0)->Arg(1000)->Arg(100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+#if defined(__SANITIZE_THREAD__)
+#define ASYMMETRIC_FENCE_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define ASYMMETRIC_FENCE_TSAN 1
+#endif
+#endif
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_membarrier) && \
+    !defined(ASYMMETRIC_FENCE_TSAN)
+#include <unistd.h>
+#define ASYMMETRIC_FENCE_MEMBARRIER 1
+#endif
+
+// 非对称屏障：频繁执行的一侧（读者）只需编译器屏障，
+// 很少执行的一侧（回收者）用 membarrier 让所有线程执行一次完整屏障，
+// 两者配对的效果等同于两侧都执行 seq_cst fence。
+// 不支持 membarrier 时两侧都退化为 seq_cst fence。
+// ThreadSanitizer 无法识别 membarrier 建立的同步，此时也使用 fence
+inline bool asymmetric_fence_available() {
+#if defined(ASYMMETRIC_FENCE_MEMBARRIER)
+  static const bool res =
+      syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0,
+              0) == 0;
+  return res;
+#else
+  return false;
+#endif
+}
+
+inline void asymmetric_light_fence() {
+  if (asymmetric_fence_available()) {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  } else {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+inline void asymmetric_heavy_fence() {
+#if defined(ASYMMETRIC_FENCE_MEMBARRIER)
+  if (asymmetric_fence_available() &&
+      syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0) {
+    return;
+  }
+#endif
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
@@ -1,199 +1,11 @@
-#include <condition_variable>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
-#include <memory>
 #include <mutex>
-#include <queue>
-#include <thread>
-#include <utility>
-
-// MessageQueue
-namespace Messaging {
-struct MessageBase {
-  virtual ~MessageBase() = default;
-};
-
-template <typename Msg>
-struct WrappedMessage : MessageBase {
-  explicit WrappedMessage(const Msg& msg) : contents(msg) {}
-  Msg contents;
-};
-
-class MessageQueue {
- public:
-  template <typename T>
-  void push(const T& msg) {
-    std::lock_guard<std::mutex> l(m_);
-    q_.push(std::make_shared<WrappedMessage<T>>(msg));
-    cv_.notify_all();
-  }
-
-  std::shared_ptr<MessageBase> wait_and_pop() {
-    std::unique_lock<std::mutex> l(m_);
-    cv_.wait(l, [&] { return !q_.empty(); });
-    auto res = q_.front();
-    q_.pop();
-    return res;
-  }
+#include <string>
 
- private:
-  std::mutex m_;
-  std::condition_variable cv_;
-  std::queue<std::shared_ptr<MessageBase>> q_;
-};
-}  // namespace Messaging
-
-//  TemplateDispatcher
-namespace Messaging {
-template <typename PreviousDispatcher, typename Msg, typename F>
-class TemplateDispatcher {
- public:
-  TemplateDispatcher(const TemplateDispatcher&) = delete;
-
-  TemplateDispatcher& operator=(const TemplateDispatcher&) = delete;
-
-  TemplateDispatcher(TemplateDispatcher&& rhs) noexcept
-      : q_(rhs.q_),
-        prev_(rhs.prev_),
-        f_(std::move(rhs.f_)),
-        chained_(rhs.chained_) {
-    rhs.chained_ = true;
-  }
-
-  TemplateDispatcher(MessageQueue* q, PreviousDispatcher* prev, F&& f)
-      : q_(q), prev_(prev), f_(std::forward<F>(f)) {
-    prev->chained_ = true;
-  }
-
-  template <typename OtherMsg, typename OtherF>
-  TemplateDispatcher<TemplateDispatcher, OtherMsg, OtherF> handle(OtherF&& f) {
-    return TemplateDispatcher<TemplateDispatcher, OtherMsg, OtherF>(
-        q_, this, std::forward<OtherF>(f));
-  }
-
-  ~TemplateDispatcher() noexcept(false) {  // 所有调度器都可能抛出异常
-    if (!chained_) {
-      wait_and_dispatch();  // 析构函数中完成任务调度
-    }
-  }
-
- private:
-  template <typename Dispatcher, typename OtherMsg, typename OtherF>
-  friend class TemplateDispatcher;  // TemplateDispatcher 实例互为友元
-
-  void wait_and_dispatch() {
-    while (true) {
-      auto msg = q_->wait_and_pop();
-      if (dispatch(msg)) {
-        break;  // 消息被处理后则退出循环
-      }
-    }
-  }
-
-  bool dispatch(const std::shared_ptr<MessageBase>& msg) {
-    if (auto wrapper = dynamic_cast<WrappedMessage<Msg>*>(msg.get())) {
-      f_(wrapper->contents);
-      return true;
-    }
-    // 如果消息类型不匹配，则链接到前一个 dispatcher
-    return prev_->dispatch(msg);
-  }
-
- private:
-  MessageQueue* q_ = nullptr;
-  PreviousDispatcher* prev_ = nullptr;
-  F f_;
-  bool chained_ = false;
-};
-}  // namespace Messaging
-
-// Dispatcher
-namespace Messaging {
-class CloseQueue {};  // 用于关闭队列的消息
-
-class Dispatcher {
- public:
-  Dispatcher(const Dispatcher&) = delete;
-
-  Dispatcher& operator=(const Dispatcher&) = delete;
-
-  Dispatcher(Dispatcher&& rhs) noexcept : q_(rhs.q_), chained_(rhs.chained_) {
-    rhs.chained_ = true;
-  }
-
-  explicit Dispatcher(MessageQueue* q) : q_(q) {}
-
-  template <typename Msg, typename F>
-  TemplateDispatcher<Dispatcher, Msg, F> handle(F&& f) {
-    // 用 TemplateDispatcher 处理特定类型的消息
-    return TemplateDispatcher<Dispatcher, Msg, F>(q_, this, std::forward<F>(f));
-  }
-
-  ~Dispatcher() noexcept(false) {  // 可能抛出 CloseQueue 异常
-    if (!chained_) {  // 从 Receiver::wait 返回的 dispatcher 实例会马上被析构
-      wait_and_dispatch();  // 析构函数中完成任务调度
-    }
-  }
-
- private:
-  template <typename Dispatcher, typename Msg, typename F>
-  friend class TemplateDispatcher;
-
-  void wait_and_dispatch() {
-    while (true) {
-      auto msg = q_->wait_and_pop();
-      dispatch(msg);
-    }
-  }
-
-  bool dispatch(const std::shared_ptr<MessageBase>& msg) {
-    if (dynamic_cast<WrappedMessage<CloseQueue>*>(msg.get())) {
-      throw CloseQueue();
-    }
-    return false;  // 返回 false 表示消息未被处理
-  }
-
- private:
-  MessageQueue* q_ = nullptr;
-  bool chained_ = false;
-};
-}  // namespace Messaging
-
-// Sender
-namespace Messaging {
-class Sender {
- public:
-  Sender() = default;
-
-  explicit Sender(MessageQueue* q) : q_(q) {}
-
-  template <typename Msg>
-  void send(const Msg& msg) {
-    if (q_) {
-      q_->push(msg);
-    }
-  }
-
- private:
-  MessageQueue* q_ = nullptr;
-};
-}  // namespace Messaging
-
-// Receiver
-namespace Messaging {
-class Receiver {
- public:
-  operator Sender() {  // 允许隐式转换为 Sender
-    return Sender(&q_);
-  }
-
-  Dispatcher wait() {  // 等待对队列的调度
-    return Dispatcher(&q_);
-  }
-
- private:
-  MessageQueue q_;
-};
-}  // namespace Messaging
+#include "messaging.hpp"
+#include "thread_poll.hpp"
 
 // ATM 消息
 struct Withdraw {
@@ -314,23 +126,28 @@ class ATM {
   ATM(Messaging::Sender bank, Messaging::Sender interface_hardware)
       : bank_(bank), interface_hardware_(interface_hardware) {}
 
-  void done() { get_sender().send(Messaging::CloseQueue()); }
+  void done() { incoming_.close(); }
 
   void run() {
     state_ = &ATM::waiting_for_card;
-    try {
-      while (true) {
-        (this->*state_)();
-      }
-    } catch (const Messaging::CloseQueue&) {
+    while ((this->*state_)() != Messaging::DispatchStatus::Closed) {
     }
   }
 
+  // 在 ex 上异步运行，不占用单独的线程
+  template <typename Executor>
+  void start(Executor& ex) {
+    state_ = &ATM::waiting_for_card;
+    incoming_.run_on(ex, [this] { (this->*state_)(); });
+  }
+
+  void wait_stopped() { incoming_.wait_stopped(); }
+
   Messaging::Sender get_sender() { return incoming_; }
 
  private:
-  void process_withdrawal() {
-    incoming_.wait()
+  Messaging::DispatchStatus process_withdrawal() {
+    return incoming_.wait()
         .handle<WithdrawOK>([&](const WithdrawOK& msg) {
           interface_hardware_.send(IssueMoney(withdrawal_amount_));
           bank_.send(WithdrawalProcessed(account_, withdrawal_amount_));
@@ -344,22 +161,24 @@ class ATM {
           bank_.send(CancelWithdrawal(account_, withdrawal_amount_));
           interface_hardware_.send(DisplayWithdrawalCancelled());
           state_ = &ATM::done_processing;
-        });
+        })
+        .receive();
   }
 
-  void process_balance() {
-    incoming_.wait()
+  Messaging::DispatchStatus process_balance() {
+    return incoming_.wait()
         .handle<Balance>([&](const Balance& msg) {
           interface_hardware_.send(DisplayBalance(msg.amount));
           state_ = &ATM::wait_for_action;
         })
         .handle<CancelPressed>(
-            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; });
+            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; })
+        .receive();
   }
 
-  void wait_for_action() {
+  Messaging::DispatchStatus wait_for_action() {
     interface_hardware_.send(DisplayWithdrawalOptions());
-    incoming_.wait()
+    return incoming_.wait()
         .handle<WithdrawPressed>([&](const WithdrawPressed& msg) {
           withdrawal_amount_ = msg.amount;
           bank_.send(Withdraw(account_, msg.amount, incoming_));
@@ -370,11 +189,12 @@ class ATM {
           state_ = &ATM::process_balance;
         })
         .handle<CancelPressed>(
-            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; });
+            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; })
+        .receive();
   }
 
-  void verifying_pin() {
-    incoming_.wait()
+  Messaging::DispatchStatus verifying_pin() {
+    return incoming_.wait()
         .handle<PINVerified>(
             [&](const PINVerified& msg) { state_ = &ATM::wait_for_action; })
         .handle<PINIncorrect>([&](const PINIncorrect& msg) {
@@ -382,11 +202,12 @@ class ATM {
           state_ = &ATM::done_processing;
         })
         .handle<CancelPressed>(
-            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; });
+            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; })
+        .receive();
   }
 
-  void getting_pin() {
-    incoming_.wait()
+  Messaging::DispatchStatus getting_pin() {
+    return incoming_.wait_for(std::chrono::seconds(30))
         .handle<DigitPressed>([&](const DigitPressed& msg) {
           const unsigned pin_length = 4;
           pin_ += msg.digit;
@@ -401,29 +222,36 @@ class ATM {
           }
         })
         .handle<CancelPressed>(
-            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; });
+            [&](const CancelPressed& msg) { state_ = &ATM::done_processing; })
+        .handle<Messaging::Timeout>([&](const Messaging::Timeout&) {
+          state_ = &ATM::done_processing;  // 长时间未输入密码则退卡
+        })
+        .receive();
   }
 
-  void waiting_for_card() {
+  Messaging::DispatchStatus waiting_for_card() {
     interface_hardware_.send(DisplayEnterCard());
-    incoming_.wait().handle<CardInserted>([&](const CardInserted& msg) {
-      account_ = msg.account;
-      pin_ = "";
-      interface_hardware_.send(DisplayEnterPIN());
-      state_ = &ATM::getting_pin;
-    });
+    return incoming_.wait()
+        .handle<CardInserted>([&](const CardInserted& msg) {
+          account_ = msg.account;
+          pin_ = "";
+          interface_hardware_.send(DisplayEnterPIN());
+          state_ = &ATM::getting_pin;
+        })
+        .receive();
   }
 
-  void done_processing() {
+  Messaging::DispatchStatus done_processing() {
     interface_hardware_.send(EjectCard());
     state_ = &ATM::waiting_for_card;
+    return Messaging::DispatchStatus::Handled;
   }
 
  private:
   Messaging::Receiver incoming_;
   Messaging::Sender bank_;
   Messaging::Sender interface_hardware_;
-  void (ATM::*state_)();
+  Messaging::DispatchStatus (ATM::*state_)();
   std::string account_;
   unsigned withdrawal_amount_;
   std::string pin_;
@@ -432,39 +260,48 @@ class ATM {
 // 银行状态机
 class BankMachine {
  public:
-  void done() { get_sender().send(Messaging::CloseQueue()); }
+  void done() { incoming_.close(); }
 
   void run() {
-    try {
-      while (true) {
-        incoming_.wait()
-            .handle<VerifyPIN>([&](const VerifyPIN& msg) {
-              if (msg.pin == "6666") {  // 输入密码为 6666 则通过验证
-                msg.atm_queue.send(PINVerified());
-              } else {  // 否则发送密码错误的消息
-                msg.atm_queue.send(PINIncorrect());
-              }
-            })
-            .handle<Withdraw>([&](const Withdraw& msg) {  // 取钱
-              if (balance_ >= msg.amount) {
-                msg.atm_queue.send(WithdrawOK());
-                balance_ -= msg.amount;
-              } else {
-                msg.atm_queue.send(WithdrawDenied());
-              }
-            })
-            .handle<GetBalance>([&](const GetBalance& msg) {
-              msg.atm_queue.send(::Balance(balance_));
-            })
-            .handle<WithdrawalProcessed>([&](const WithdrawalProcessed& msg) {})
-            .handle<CancelWithdrawal>([&](const CancelWithdrawal& msg) {});
-      }
-    } catch (const Messaging::CloseQueue&) {
+    while (serve() != Messaging::DispatchStatus::Closed) {
     }
   }
 
+  template <typename Executor>
+  void start(Executor& ex) {
+    incoming_.run_on(ex, [this] { serve(); });
+  }
+
+  void wait_stopped() { incoming_.wait_stopped(); }
+
   Messaging::Sender get_sender() { return incoming_; }
 
+ private:
+  Messaging::DispatchStatus serve() {
+    return incoming_.wait()
+        .handle<VerifyPIN>([&](const VerifyPIN& msg) {
+          if (msg.pin == "6666") {  // 输入密码为 6666 则通过验证
+            msg.atm_queue.send(PINVerified());
+          } else {  // 否则发送密码错误的消息
+            msg.atm_queue.send(PINIncorrect());
+          }
+        })
+        .handle<Withdraw>([&](const Withdraw& msg) {  // 取钱
+          if (balance_ >= msg.amount) {
+            msg.atm_queue.send(WithdrawOK());
+            balance_ -= msg.amount;
+          } else {
+            msg.atm_queue.send(WithdrawDenied());
+          }
+        })
+        .handle<GetBalance>([&](const GetBalance& msg) {
+          msg.atm_queue.send(::Balance(balance_));
+        })
+        .handle<WithdrawalProcessed>([&](const WithdrawalProcessed& msg) {})
+        .handle<CancelWithdrawal>([&](const CancelWithdrawal& msg) {})
+        .receive();
+  }
+
  private:
   Messaging::Receiver incoming_;
   unsigned balance_ = 199;
@@ -473,80 +310,89 @@ class BankMachine {
 // 用户接口状态机
 class InterfaceMachine {
  public:
-  void done() { get_sender().send(Messaging::CloseQueue()); }
+  void done() { incoming_.close(); }
 
   void run() {
-    try {
-      while (true) {
-        incoming_.wait()
-            .handle<IssueMoney>([&](const IssueMoney& msg) {
+    while (serve() != Messaging::DispatchStatus::Closed) {
+    }
+  }
+
+  template <typename Executor>
+  void start(Executor& ex) {
+    incoming_.run_on(ex, [this] { serve(); });
+  }
+
+  void wait_stopped() { incoming_.wait_stopped(); }
+
+  Messaging::Sender get_sender() { return incoming_; }
+
+ private:
+  Messaging::DispatchStatus serve() {
+    return incoming_.wait()
+        .handle<IssueMoney>([&](const IssueMoney& msg) {
+          {
+            std::lock_guard<std::mutex> l(m_);
+            std::cout << "Issuing " << msg.amount << std::endl;
+          }
+        })
+        .handle<DisplayInsufficientFunds>(
+            [&](const DisplayInsufficientFunds& msg) {
               {
                 std::lock_guard<std::mutex> l(m_);
-                std::cout << "Issuing " << msg.amount << std::endl;
+                std::cout << "Insufficient funds" << std::endl;
               }
             })
-            .handle<DisplayInsufficientFunds>(
-                [&](const DisplayInsufficientFunds& msg) {
-                  {
-                    std::lock_guard<std::mutex> l(m_);
-                    std::cout << "Insufficient funds" << std::endl;
-                  }
-                })
-            .handle<DisplayEnterPIN>([&](const DisplayEnterPIN& msg) {
+        .handle<DisplayEnterPIN>([&](const DisplayEnterPIN& msg) {
+          {
+            std::lock_guard<std::mutex> l(m_);
+            std::cout << "Please enter your PIN (0-9)" << std::endl;
+          }
+        })
+        .handle<DisplayEnterCard>([&](const DisplayEnterCard& msg) {
+          {
+            std::lock_guard<std::mutex> l(m_);
+            std::cout << "Please enter your card (I)" << std::endl;
+          }
+        })
+        .handle<DisplayBalance>([&](const DisplayBalance& msg) {
+          {
+            std::lock_guard<std::mutex> l(m_);
+            std::cout << "The Balance of your account is " << msg.amount
+                      << std::endl;
+          }
+        })
+        .handle<DisplayWithdrawalOptions>(
+            [&](const DisplayWithdrawalOptions& msg) {
               {
                 std::lock_guard<std::mutex> l(m_);
-                std::cout << "Please enter your PIN (0-9)" << std::endl;
+                std::cout << "Withdraw 50? (w)" << std::endl;
+                std::cout << "Display Balance? (b)" << std::endl;
+                std::cout << "Cancel? (c)" << std::endl;
               }
             })
-            .handle<DisplayEnterCard>([&](const DisplayEnterCard& msg) {
+        .handle<DisplayWithdrawalCancelled>(
+            [&](const DisplayWithdrawalCancelled& msg) {
               {
                 std::lock_guard<std::mutex> l(m_);
-                std::cout << "Please enter your card (I)" << std::endl;
+                std::cout << "Withdrawal cancelled" << std::endl;
               }
             })
-            .handle<DisplayBalance>([&](const DisplayBalance& msg) {
+        .handle<DisplayPINIncorrectMessage>(
+            [&](const DisplayPINIncorrectMessage& msg) {
               {
                 std::lock_guard<std::mutex> l(m_);
-                std::cout << "The Balance of your account is " << msg.amount
-                          << std::endl;
+                std::cout << "PIN incorrect" << std::endl;
               }
             })
-            .handle<DisplayWithdrawalOptions>(
-                [&](const DisplayWithdrawalOptions& msg) {
-                  {
-                    std::lock_guard<std::mutex> l(m_);
-                    std::cout << "Withdraw 50? (w)" << std::endl;
-                    std::cout << "Display Balance? (b)" << std::endl;
-                    std::cout << "Cancel? (c)" << std::endl;
-                  }
-                })
-            .handle<DisplayWithdrawalCancelled>(
-                [&](const DisplayWithdrawalCancelled& msg) {
-                  {
-                    std::lock_guard<std::mutex> l(m_);
-                    std::cout << "Withdrawal cancelled" << std::endl;
-                  }
-                })
-            .handle<DisplayPINIncorrectMessage>(
-                [&](const DisplayPINIncorrectMessage& msg) {
-                  {
-                    std::lock_guard<std::mutex> l(m_);
-                    std::cout << "PIN incorrect" << std::endl;
-                  }
-                })
-            .handle<EjectCard>([&](const EjectCard& msg) {
-              {
-                std::lock_guard<std::mutex> l(m_);
-                std::cout << "Ejecting card" << std::endl;
-              }
-            });
-      }
-    } catch (Messaging::CloseQueue&) {
-    }
+        .handle<EjectCard>([&](const EjectCard& msg) {
+          {
+            std::lock_guard<std::mutex> l(m_);
+            std::cout << "Ejecting card" << std::endl;
+          }
+        })
+        .receive();
   }
 
-  Messaging::Sender get_sender() { return incoming_; }
-
  private:
   Messaging::Receiver incoming_;
   std::mutex m_;
@@ -556,9 +402,11 @@ int main() {
   BankMachine bank;
   InterfaceMachine interface_hardware;
   ATM machine{bank.get_sender(), interface_hardware.get_sender()};
-  std::thread bank_thread{&BankMachine::run, &bank};
-  std::thread interface_thread{&InterfaceMachine::run, &interface_hardware};
-  std::thread atm_thread{&ATM::run, &machine};
+  // 三个状态机共享两个工作线程，也可以用 run 各占一个线程
+  ThreadPool pool{2};
+  bank.start(pool);
+  interface_hardware.start(pool);
+  machine.start(pool);
   Messaging::Sender atm_queue{machine.get_sender()};
   bool quit = false;
   while (!quit) {
@@ -596,7 +444,7 @@ int main() {
   bank.done();
   machine.done();
   interface_hardware.done();
-  atm_thread.join();
-  bank_thread.join();
-  interface_thread.join();
+  machine.wait_stopped();
+  bank.wait_stopped();
+  interface_hardware.wait_stopped();
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 最低位 1 的下标，要求 x 不为 0
+inline int lowest_bit(std::uint64_t x) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long i;
+  _BitScanForward64(&i, x);
+  return static_cast<int>(i);
+#elif defined(_MSC_VER)
+  unsigned long i;
+  if (_BitScanForward(&i, static_cast<unsigned long>(x))) {
+    return static_cast<int>(i);
+  }
+  _BitScanForward(&i, static_cast<unsigned long>(x >> 32));
+  return static_cast<int>(i) + 32;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+// 最高位 1 的下标，要求 x 不为 0
+inline int highest_bit(std::uint64_t x) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long i;
+  _BitScanReverse64(&i, x);
+  return static_cast<int>(i);
+#elif defined(_MSC_VER)
+  unsigned long i;
+  if (_BitScanReverse(&i, static_cast<unsigned long>(x >> 32))) {
+    return static_cast<int>(i) + 32;
+  }
+  _BitScanReverse(&i, static_cast<unsigned long>(x));
+  return static_cast<int>(i);
+#else
+  return 63 - __builtin_clzll(x);
+#endif
+}
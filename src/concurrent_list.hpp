@@ -4,13 +4,20 @@
 #include <mutex>
 #include <utility>
 
-template <typename T>
+// Allocator 用于分配节点和元素，需要无状态且可默认构造，如 PoolAllocator<T>。
+// 每个节点都有一个 Mutex，遍历时交替加锁，见 lock_policy.hpp
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Mutex = std::mutex>
 class ConcurrentList {
  public:
   ConcurrentList() = default;
 
+  // 逐个释放节点，避免 unique_ptr 链递归析构
   ~ConcurrentList() {
-    remove_if([](const Node&) { return true; });
+    NodePtr p = std::move(head_.next);
+    while (p) {
+      p = std::move(p->next);
+    }
   }
 
   ConcurrentList(const ConcurrentList&) = delete;
@@ -18,8 +25,8 @@ class ConcurrentList {
   ConcurrentList& operator=(const ConcurrentList&) = delete;
 
   void push_front(const T& x) {
-    std::unique_ptr<Node> t(new Node(x));
-    std::lock_guard<std::mutex> head_lock(head_.m);
+    NodePtr t = make_node(x);
+    std::lock_guard<Mutex> head_lock(head_.m);
     t->next = std::move(head_.next);
     head_.next = std::move(t);
   }
@@ -27,9 +34,9 @@ class ConcurrentList {
   template <typename F>
   void for_each(F f) {
     Node* cur = &head_;
-    std::unique_lock<std::mutex> head_lock(head_.m);
+    std::unique_lock<Mutex> head_lock(head_.m);
     while (Node* const next = cur->next.get()) {
-      std::unique_lock<std::mutex> next_lock(next->m);
+      std::unique_lock<Mutex> next_lock(next->m);
       head_lock.unlock();  // 锁住了下一节点，因此可以释放上一节点的锁
       f(*next->data);
       cur = next;                        // 当前节点指向下一节点
@@ -40,9 +47,9 @@ class ConcurrentList {
   template <typename F>
   std::shared_ptr<T> find_first_if(F f) {
     Node* cur = &head_;
-    std::unique_lock<std::mutex> head_lock(head_.m);
+    std::unique_lock<Mutex> head_lock(head_.m);
     while (Node* const next = cur->next.get()) {
-      std::unique_lock<std::mutex> next_lock(next->m);
+      std::unique_lock<Mutex> next_lock(next->m);
       head_lock.unlock();
       if (f(*next->data)) {
         return next->data;  // 返回目标值，无需继续查找
@@ -56,11 +63,11 @@ class ConcurrentList {
   template <typename F>
   void remove_if(F f) {
     Node* cur = &head_;
-    std::unique_lock<std::mutex> head_lock(head_.m);
+    std::unique_lock<Mutex> head_lock(head_.m);
     while (Node* const next = cur->next.get()) {
-      std::unique_lock<std::mutex> next_lock(next->m);
+      std::unique_lock<Mutex> next_lock(next->m);
       if (f(*next->data)) {  // 为 true 则移除下一节点
-        std::unique_ptr<Node> old_next = std::move(cur->next);
+        NodePtr old_next = std::move(cur->next);
         cur->next = std::move(next->next);  // 下一节点设为下下节点
         next_lock.unlock();
       } else {  // 否则继续转至下一节点
@@ -72,13 +79,41 @@ class ConcurrentList {
   }
 
  private:
+  struct Node;
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  struct NodeDeleter {
+    void operator()(Node* p) const noexcept {
+      NodeAllocator a;
+      NodeTraits::destroy(a, p);
+      NodeTraits::deallocate(a, p, 1);
+    }
+  };
+
+  using NodePtr = std::unique_ptr<Node, NodeDeleter>;
+
   struct Node {
-    std::mutex m;
+    Mutex m;
     std::shared_ptr<T> data;
-    std::unique_ptr<Node> next;
+    NodePtr next;
     Node() = default;
-    Node(const T& x) : data(std::make_shared<T>(x)) {}
+    Node(const T& x) : data(std::allocate_shared<T>(Allocator{}, x)) {}
   };
 
+  static NodePtr make_node(const T& x) {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    try {
+      NodeTraits::construct(a, p, x);
+    } catch (...) {
+      NodeTraits::deallocate(a, p, 1);
+      throw;
+    }
+    return NodePtr(p);
+  }
+
   Node head_;
 };
@@ -1,92 +1,503 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
-template <typename K, typename V, typename Hash = std::hash<K>>
+#include "metrics.hpp"
+
+// ConcurrentMap 默认的桶，用链表存放元素。
+// SharedMutex 也可以是 ExclusiveAsShared 包装的自旋锁，见 lock_policy.hpp
+template <typename K, typename V, typename SharedMutex = std::shared_mutex>
+struct ListBucket {
+  static constexpr std::size_t MaxLoad = 1;  // 平均每个桶的元素数超过它时扩容
+  // 节点可能在读取时被释放，不支持无锁读
+  static constexpr bool OptimisticRead = false;
+
+  using Mutex = SharedMutex;
+
+  std::list<std::pair<K, V>> data;
+  mutable Mutex m;        // 每个桶都用这个锁保护
+  bool migrated = false;  // 元素已全部迁移到新表，不再使用
+
+  // 以下函数均要求调用者持有 m，Q 为 K 或透明哈希下可与 K 比较的类型
+  template <typename Q>
+  const V* find(const Q& k, std::size_t) const {
+    auto it = std::find_if(data.begin(), data.end(),
+                           [&](auto& x) { return x.first == k; });
+    return it == data.end() ? nullptr : &it->second;
+  }
+
+  template <typename Q>
+  V* find(const Q& k, std::size_t h) {
+    return const_cast<V*>(std::as_const(*this).find(k, h));
+  }
+
+  // 调用者保证 k 不存在，用 args 构造值
+  template <typename... Args>
+  V& insert_new(const K& k, std::size_t, Args&&... args) {
+    data.emplace_back(std::piecewise_construct, std::forward_as_tuple(k),
+                      std::forward_as_tuple(std::forward<Args>(args)...));
+    chain_length().record(data.size());
+    return data.back().second;  // emplace_back 异常安全
+  }
+
+  template <typename Q>
+  bool erase(const Q& k, std::size_t) {
+    auto it = std::find_if(data.begin(), data.end(),
+                           [&](auto& x) { return x.first == k; });
+    if (it == data.end()) {
+      return false;
+    }
+    data.erase(it);
+    return true;
+  }
+
+  template <typename F>
+  void for_each(F&& f) const {
+    for (auto& x : data) {
+      f(x.first, x.second);
+    }
+  }
+
+  // 插入后链表的长度，见 metrics.hpp
+  static Histogram& chain_length() {
+    static Histogram res("concurrent_map_chain_length");
+    return res;
+  }
+
+  // 把节点逐个移动到 sink(哈希值) 返回的桶中，splice 不会分配内存也不会抛异常。
+  // 哈希函数可能抛异常时先算出所有哈希值，抛异常时本桶不变
+  template <typename HashFn, typename Sink>
+  void migrate(const HashFn& hash, Sink&& sink) {
+    if constexpr (std::is_nothrow_invocable_v<const HashFn&, const K&>) {
+      while (!data.empty()) {
+        splice_front(sink(hash(data.front().first)));
+      }
+    } else {
+      std::vector<std::size_t> hashes;
+      hashes.reserve(data.size());
+      for (auto& x : data) {
+        hashes.push_back(hash(x.first));
+      }
+      for (std::size_t h : hashes) {
+        splice_front(sink(h));
+      }
+    }
+  }
+
+  void splice_front(ListBucket& to) {
+    std::unique_lock<Mutex> l(to.m);
+    to.data.splice(to.data.end(), data, data.begin());
+  }
+};
+
+// Bucket 决定桶内元素的存储方式，
+// 可选 ListBucket 或 flat_bucket.hpp 中的 FlatBucket。
+// 元素数超过桶数与最大负载因子之积时，新建一张约两倍大小的表，
+// 旧表中的桶由之后的每次操作顺带迁移几个，不会让所有线程停下来等待整体重哈希。
+// 一个键在迁移完成前位于旧表的桶中，迁移后位于新表的桶中。
+// 旧表在析构前不会释放，因此无锁读取表指针的线程总能安全访问它
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Bucket = ListBucket<K, V>>
 class ConcurrentMap {
  public:
-  // 桶数默认为 19（一般用 x % 桶数作为 x 的桶索引，桶数为质数可使桶分布均匀）
-  ConcurrentMap(std::size_t n = 19, const Hash& h = Hash{})
-      : buckets_(n), hasher_(h) {
-    for (auto& x : buckets_) {
-      x.reset(new Bucket);
-    }
+  // 初始桶数默认为 19，扩容时取两倍之后的下一个质数
+  // （一般用 x % 桶数作为 x 的桶索引，桶数为质数可使桶分布均匀）
+  ConcurrentMap(std::size_t n = 19, const Hash& h = Hash{}) : hasher_(h) {
+    tables_.emplace_back(new Table(std::max<std::size_t>(n, 1)));
+    table_.store(tables_.back().get(), std::memory_order_release);
   }
 
   ConcurrentMap(const ConcurrentMap&) = delete;
 
   ConcurrentMap& operator=(const ConcurrentMap&) = delete;
 
+  // 返回值的副本，接受 Q 的重载只在 Hash 定义了 is_transparent 时可用，
+  // 例如存储 std::string 时可直接用 std::string_view 查找而不构造临时的键
   V get(const K& k, const V& default_value = V{}) const {
-    return get_bucket(k).get(k, default_value);
+    return get_impl(k, default_value);
   }
 
-  void set(const K& k, const V& v) { get_bucket(k).set(k, v); }
+  template <typename Q, typename H = Hash,
+            typename = typename H::is_transparent>
+  V get(const Q& k, const V& default_value = V{}) const {
+    return get_impl(k, default_value);
+  }
 
-  void erase(const K& k) { get_bucket(k).erase(k); }
+  // 键存在时在桶的共享锁下调用 f(const V&)，避免复制值，返回键是否存在。
+  // f 中不能修改本表
+  template <typename F>
+  bool find_if_present(const K& k, F f) const {
+    return find_if_present_impl(k, f);
+  }
 
-  // 为了方便使用，提供一个到 std::map 的映射
-  std::map<K, V> to_map() const {
-    std::vector<std::unique_lock<std::shared_mutex>> locks;
-    for (auto& x : buckets_) {
-      locks.emplace_back(std::unique_lock<std::shared_mutex>(x->m));
-    }
-    std::map<K, V> res;
-    for (auto& x : buckets_) {
-      for (auto& y : x->data) {
-        res.emplace(y);
+  template <typename Q, typename F, typename H = Hash,
+            typename = typename H::is_transparent>
+  bool find_if_present(const Q& k, F f) const {
+    return find_if_present_impl(k, f);
+  }
+
+  void set(const K& k, const V& v) {
+    modify(k, [&](Bucket& b, std::size_t h) {
+      if (V* p = b.find(k, h)) {
+        *p = v;  // 赋值可能抛异常，但值是用户提供的，可放心让用户处理
+        return false;
       }
+      b.insert_new(k, h, v);
+      return true;
+    });
+  }
+
+  // 键不存在时用 args 构造值并插入，已存在时不做任何事，返回是否插入
+  template <typename... Args>
+  bool emplace(const K& k, Args&&... args) {
+    return modify(k, [&](Bucket& b, std::size_t h) {
+      if (b.find(k, h)) {
+        return false;
+      }
+      b.insert_new(k, h, std::forward<Args>(args)...);
+      return true;
+    });
+  }
+
+  // 在桶的独占锁下调用 f(V&) 原地修改值，键不存在时先插入 init，
+  // 读改写只需加一次锁，如计数 upsert(k, [](int& x) { ++x; })。返回是否插入
+  template <typename F>
+  bool upsert(const K& k, F f, const V& init = V{}) {
+    return modify(k, [&](Bucket& b, std::size_t h) {
+      if (V* p = b.find(k, h)) {
+        f(*p);
+        return false;
+      }
+      f(b.insert_new(k, h, init));
+      return true;
+    });
+  }
+
+  void erase(const K& k) { erase_impl(k); }
+
+  template <typename Q, typename H = Hash,
+            typename = typename H::is_transparent>
+  void erase(const Q& k) {
+    erase_impl(k);
+  }
+
+  std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  std::size_t bucket_count() const {
+    return table_.load(std::memory_order_acquire)->buckets.size();
+  }
+
+  // 逐个桶加共享锁调用 f(k, v)，同一时刻只锁住一个桶，不会阻塞其他桶的读写。
+  // 遍历期间暂停扩容，开始前已存在且遍历中未被删除的元素恰好访问一次，
+  // 遍历中插入或删除的元素不保证被访问到。f 中不能修改本表
+  template <typename F>
+  void for_each(F f) const {
+    IterationGuard guard(*this);
+    for (auto& x : guard.table()->buckets) {
+      std::shared_lock<Mutex> l(x.m);
+      x.for_each(f);
     }
+  }
+
+  // 把所有元素复制到 res 中，复用 res 已有的容量
+  void to_vector(std::vector<std::pair<K, V>>& res) const {
+    res.clear();
+    res.reserve(size());
+    for_each([&](const K& k, const V& v) { res.emplace_back(k, v); });
+  }
+
+  // 为了方便使用，提供一个到 std::map 的映射，一致性与 for_each 相同
+  std::map<K, V> to_map() const {
+    std::map<K, V> res;
+    for_each([&](const K& k, const V& v) { res.emplace(k, v); });
     return res;
   }
 
  private:
-  struct Bucket {
-    std::list<std::pair<K, V>> data;
-    mutable std::shared_mutex m;  // 每个桶都用这个锁保护
+  static constexpr std::size_t MigrateBatch = 2;  // 每次操作迁移的桶数
+  // 无锁读连续失败这么多次后改为加共享锁，避免写多时读者饥饿
+  static constexpr std::size_t OptimisticRetries = 4;
+
+  using Mutex = typename Bucket::Mutex;
 
-    V get(const K& k, const V& default_value) const {
-      // 没有修改任何值，异常安全
-      std::shared_lock<std::shared_mutex> l(m);  // 只读锁，可共享
-      auto it = std::find_if(data.begin(), data.end(),
-                             [&](auto& x) { return x.first == k; });
-      return it == data.end() ? default_value : it->second;
+  struct Table {
+    explicit Table(std::size_t n) : buckets(n) {}
+
+    Bucket& bucket(std::size_t h) { return buckets[h % buckets.size()]; }
+
+    std::vector<Bucket> buckets;
+    std::atomic<Table*> next = nullptr;  // 扩容后的新表
+    std::atomic<Table*> old = nullptr;   // 正在迁移到本表的旧表，迁移完成后置空
+    std::atomic<std::size_t> migrate_pos = 0;  // 下一个待认领的旧桶
+    std::atomic<std::size_t> migrated_cnt = 0;
+    // 有旧桶迁移失败，认领完所有桶后需要重新扫描，见 help_migrate
+    std::atomic<bool> migrate_failed = false;
+    std::mutex rescan_m;
+  };
+
+  // 加锁并返回哈希值 h 的键当前所在的桶。
+  // 迁移过的桶不再存放元素，此时沿 next 转到新表中对应的桶继续查找。
+  // 任何时刻只持有一个桶的锁，迁移时才会按旧表到新表的顺序持有两个
+  template <typename Lock>
+  Bucket& lock_bucket(std::size_t h, Lock& l) const {
+    Table* t = first_table();
+    while (true) {
+      Bucket& b = t->bucket(h);
+      l = Lock(b.m);
+      if (!b.migrated) {
+        return b;
+      }
+      l.unlock();
+      t = t->next.load(std::memory_order_acquire);
     }
+  }
 
-    void set(const K& k, const V& v) {
-      std::unique_lock<std::shared_mutex> l(m);  // 写，单独占用
-      auto it = std::find_if(data.begin(), data.end(),
-                             [&](auto& x) { return x.first == k; });
-      if (it == data.end()) {
-        data.emplace_back(k, v);  // emplace_back 异常安全
-      } else {
-        it->second = v;  // 赋值可能抛异常，但值是用户提供的，可放心让用户处理
+  template <typename Q>
+  V get_impl(const Q& k, const V& default_value) const {
+    const std::size_t h = hasher_(k);
+    help_migrate();
+    if constexpr (Bucket::OptimisticRead) {
+      V res = default_value;
+      for (std::size_t i = 0; i < OptimisticRetries; ++i) {
+        if (try_get_unlocked(k, h, default_value, res)) {
+          return res;
+        }
       }
     }
+    std::shared_lock<Mutex> l;  // 只读锁，可共享
+    const V* p = lock_bucket(h, l).find(k, h);
+    return p ? *p : default_value;  // 没有修改任何值，异常安全
+  }
 
-    void erase(const K& k) {
-      std::unique_lock<std::shared_mutex> l(m);  // 写，单独占用
-      auto it = std::find_if(data.begin(), data.end(),
-                             [&](auto& x) { return x.first == k; });
-      if (it != data.end()) {
-        data.erase(it);
+  template <typename Q, typename F>
+  bool find_if_present_impl(const Q& k, F& f) const {
+    const std::size_t h = hasher_(k);
+    help_migrate();
+    std::shared_lock<Mutex> l;
+    const V* p = lock_bucket(h, l).find(k, h);
+    if (!p) {
+      return false;
+    }
+    f(*p);
+    return true;
+  }
+
+  // 在 k 所在的桶上加独占锁调用 f(桶, 哈希值)，f 返回是否插入了新元素
+  template <typename F>
+  bool modify(const K& k, F f) {
+    const std::size_t h = hasher_(k);
+    help_migrate();
+    bool inserted;
+    {
+      std::unique_lock<Mutex> l;  // 写，单独占用
+      inserted = f(lock_bucket(h, l), h);
+    }
+    if (inserted) {
+      grow_if_needed(size_.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+    return inserted;
+  }
+
+  template <typename Q>
+  void erase_impl(const Q& k) {
+    const std::size_t h = hasher_(k);
+    help_migrate();
+    std::unique_lock<Mutex> l;
+    if (lock_bucket(h, l).erase(k, h)) {
+      size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // 存在时禁止开始新的扩容，并等待当前的迁移完成，保证遍历的表不再变化
+  class IterationGuard {
+   public:
+    explicit IterationGuard(const ConcurrentMap& m) : m_(m) {
+      {
+        std::lock_guard<std::mutex> l(m_.resize_m_);
+        ++m_.iteration_cnt_;
+        table_ = m_.table_.load(std::memory_order_acquire);
       }
+      try {
+        while (table_->old.load(std::memory_order_acquire)) {
+          m_.help_migrate();
+          std::this_thread::yield();
+        }
+      } catch (...) {
+        release();
+        throw;
+      }
+    }
+
+    ~IterationGuard() { release(); }
+
+    IterationGuard(const IterationGuard&) = delete;
+
+    IterationGuard& operator=(const IterationGuard&) = delete;
+
+    Table* table() const { return table_; }
+
+   private:
+    void release() {
+      std::lock_guard<std::mutex> l(m_.resize_m_);
+      --m_.iteration_cnt_;
     }
+
+   private:
+    const ConcurrentMap& m_;
+    Table* table_ = nullptr;
   };
 
-  Bucket& get_bucket(const K& k) const {  // 桶数固定因此可以无锁调用
-    return *buckets_[hasher_(k) % buckets_.size()];
+  // 不加锁查找，通过桶的序号检验读取期间没有写者，否则返回 false。
+  // 迁移标志也在序号保护下读取，与 lock_bucket 一样沿 next 转到新表
+  template <typename Q>
+  bool try_get_unlocked(const Q& k, std::size_t h, const V& default_value,
+                        V& res) const {
+    Table* t = first_table();
+    while (true) {
+      const Bucket& b = t->bucket(h);
+      const std::uint32_t seq = b.m.read_begin();
+      if (seq & 1) {
+        return false;
+      }
+      const bool migrated = b.migrated;
+      const bool found = !migrated && b.get_unlocked(k, h, res);
+      if (!b.m.read_validate(seq)) {
+        return false;
+      }
+      if (!migrated) {
+        if (!found) {
+          res = default_value;
+        }
+        return true;
+      }
+      t = t->next.load(std::memory_order_acquire);
+    }
+  }
+
+  // 正在迁移时键可能还在旧表中，从旧表开始查找
+  Table* first_table() const {
+    Table* t = table_.load(std::memory_order_acquire);
+    if (Table* old = t->old.load(std::memory_order_acquire)) {
+      return old;
+    }
+    return t;
+  }
+
+  // 扩容期间每次操作认领并迁移几个旧桶，最后一个完成的线程结束本次迁移。
+  // 迁移一个桶抛异常时该桶不变，异常继续抛给本次操作，并标记 migrate_failed。
+  // 之后认领完所有桶的操作逐个检查旧桶，迁移遗漏的桶，使迁移最终能够完成
+  void help_migrate() const {
+    Table* t = table_.load(std::memory_order_acquire);
+    Table* old = t->old.load(std::memory_order_acquire);
+    if (!old) {
+      return;
+    }
+    const std::size_t n = old->buckets.size();
+    for (std::size_t i = 0; i < MigrateBatch; ++i) {
+      const std::size_t idx =
+          t->migrate_pos.fetch_add(1, std::memory_order_relaxed);
+      if (idx >= n) {
+        if (t->migrate_failed.load(std::memory_order_acquire)) {
+          rescan_migration(*old, *t);
+        }
+        return;
+      }
+      try_migrate_bucket(old->buckets[idx], *t, n);
+    }
+  }
+
+  // 同一时刻只有一个线程扫描，先清除标记，扫描期间的失败会再次设置它
+  void rescan_migration(Table& old, Table& t) const {
+    std::unique_lock<std::mutex> l(t.rescan_m, std::try_to_lock);
+    if (!l.owns_lock()) {
+      return;
+    }
+    t.migrate_failed.store(false, std::memory_order_relaxed);
+    for (Bucket& b : old.buckets) {
+      try_migrate_bucket(b, t, old.buckets.size());
+    }
+  }
+
+  void try_migrate_bucket(Bucket& from, Table& to, std::size_t n) const {
+    bool done;
+    try {
+      done = migrate_bucket(from, to);
+    } catch (...) {
+      to.migrate_failed.store(true, std::memory_order_release);
+      throw;
+    }
+    if (done &&
+        to.migrated_cnt.fetch_add(1, std::memory_order_acq_rel) + 1 == n) {
+      to.old.store(nullptr, std::memory_order_release);
+    }
+  }
+
+  // Bucket::migrate 要求强异常安全：抛异常时所有元素仍在 from 中。
+  // 已被其他线程迁移时返回 false
+  bool migrate_bucket(Bucket& from, Table& to) const {
+    std::unique_lock<Mutex> l(from.m);
+    if (from.migrated) {
+      return false;
+    }
+    from.migrate(hasher_,
+                 [&](std::size_t h) -> Bucket& { return to.bucket(h); });
+    from.migrated = true;
+    return true;
+  }
+
+  // 上一次迁移未完成时不扩容，保证键最多分布在相邻的两张表中
+  void grow_if_needed(std::size_t n) {
+    Table* t = table_.load(std::memory_order_acquire);
+    if (n <= t->buckets.size() * Bucket::MaxLoad ||
+        t->old.load(std::memory_order_acquire)) {
+      return;
+    }
+    // 已有线程在扩容时直接返回，不阻塞写操作，有遍历时推迟到之后的插入
+    std::unique_lock<std::mutex> l(resize_m_, std::try_to_lock);
+    if (!l.owns_lock() || iteration_cnt_ > 0 ||
+        t != table_.load(std::memory_order_acquire) ||
+        t->old.load(std::memory_order_acquire)) {
+      return;
+    }
+    tables_.emplace_back(new Table(next_prime(t->buckets.size() * 2)));
+    Table* new_table = tables_.back().get();
+    new_table->old.store(t, std::memory_order_relaxed);
+    t->next.store(new_table, std::memory_order_release);  // 先于发布新表
+    table_.store(new_table, std::memory_order_release);
+  }
+
+  static std::size_t next_prime(std::size_t n) {
+    for (;; ++n) {
+      bool is_prime = n >= 2;
+      for (std::size_t i = 2; i * i <= n && is_prime; ++i) {
+        is_prime = n % i != 0;
+      }
+      if (is_prime) {
+        return n;
+      }
+    }
   }
 
  private:
-  std::vector<std::unique_ptr<Bucket>> buckets_;
+  std::atomic<Table*> table_ = nullptr;  // 最新的表
+  std::atomic<std::size_t> size_ = 0;
+  mutable std::mutex resize_m_;            // 保护 tables_ 和 iteration_cnt_
+  mutable std::size_t iteration_cnt_ = 0;  // 正在进行的遍历数
+  // 所有表，包括已迁移完的旧表
+  std::vector<std::unique_ptr<Table>> tables_;
   Hash hasher_;
 };
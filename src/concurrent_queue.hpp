@@ -1,25 +1,34 @@
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <utility>
 
-template <typename T>
+#include "lock_policy.hpp"
+#include "metrics.hpp"
+
+// Allocator 用于分配节点和元素，需要无状态且可默认构造，如 PoolAllocator<T>。
+// Mutex 保护头尾指针，临界区只有几次指针操作，可以换用 lock_policy.hpp 中的锁。
+// 开启指标时记录 push 和 pop 对两个锁的竞争，见 metrics.hpp
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Mutex = std::mutex>
 class ConcurrentQueue {
  public:
-  ConcurrentQueue() : head_(new Node), tail_(head_.get()) {}
+  ConcurrentQueue() : head_(make_node()), tail_(head_.get()) {}
 
   ConcurrentQueue(const ConcurrentQueue&) = delete;
 
   ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
 
   void push(T x) {
-    auto new_val = std::make_shared<T>(std::move(x));
-    auto new_node = std::make_unique<Node>();
+    auto new_val = std::allocate_shared<T>(Allocator{}, std::move(x));
+    NodePtr new_node = make_node();
     Node* new_tail_node = new_node.get();
     {
-      std::lock_guard<std::mutex> l(tail_mutex_);
+      MeteredLockGuard<Mutex> l(tail_mutex_, tail_lock_metrics());
       tail_->v = new_val;
       tail_->next = std::move(new_node);
       tail_ = new_tail_node;
@@ -27,45 +36,139 @@ class ConcurrentQueue {
     cv_.notify_one();
   }
 
+  // 在锁外把所有元素串成一条链表，加锁一次接到尾部，并只通知一次
+  template <typename InputIt>
+  void push_bulk(InputIt first, InputIt last) {
+    if (first == last) {
+      return;
+    }
+    auto first_val = std::allocate_shared<T>(Allocator{}, *first);
+    NodePtr first_node = make_node();
+    Node* new_tail_node = first_node.get();
+    for (++first; first != last; ++first) {
+      new_tail_node->v = std::allocate_shared<T>(Allocator{}, *first);
+      new_tail_node->next = make_node();
+      new_tail_node = new_tail_node->next.get();
+    }
+    {
+      MeteredLockGuard<Mutex> l(tail_mutex_, tail_lock_metrics());
+      tail_->v = std::move(first_val);
+      tail_->next = std::move(first_node);
+      tail_ = new_tail_node;
+    }
+    cv_.notify_all();
+  }
+
   std::shared_ptr<T> try_pop() {
-    std::unique_ptr<Node> head_node = try_pop_head();
+    NodePtr head_node = try_pop_head();
     return head_node ? head_node->v : nullptr;
   }
 
   bool try_pop(T& res) {
-    std::unique_ptr<Node> head_node = try_pop_head(res);
+    NodePtr head_node = try_pop_head(res);
     return head_node != nullptr;
   }
 
   std::shared_ptr<T> wait_and_pop() {
-    std::unique_ptr<Node> head_node = wait_pop_head();
+    NodePtr head_node = wait_pop_head();
     return head_node->v;
   }
 
   void wait_and_pop(T& res) { wait_pop_head(res); }
 
+  // 超时返回 nullptr
+  template <typename Rep, typename Period>
+  std::shared_ptr<T> wait_and_pop_for(
+      const std::chrono::duration<Rep, Period>& timeout) {
+    head_lock_metrics().lock(head_mutex_);
+    std::unique_lock<Mutex> l(head_mutex_, std::adopt_lock);
+    if (!cv_.wait_for(l, timeout,
+                      [this] { return head_.get() != get_tail(); })) {
+      return nullptr;
+    }
+    return pop_head()->v;
+  }
+
+  template <typename Rep, typename Period>
+  bool wait_and_pop_for(T& res,
+                        const std::chrono::duration<Rep, Period>& timeout) {
+    head_lock_metrics().lock(head_mutex_);
+    std::unique_lock<Mutex> l(head_mutex_, std::adopt_lock);
+    if (!cv_.wait_for(l, timeout,
+                      [this] { return head_.get() != get_tail(); })) {
+      return false;
+    }
+    res = std::move(*head_->v);
+    pop_head();
+    return true;
+  }
+
+  // 加锁一次取出至多 max 个元素写入 out，返回取出的个数
+  template <typename OutputIt>
+  std::size_t try_pop_bulk(OutputIt out, std::size_t max) {
+    NodePtr old_head;
+    std::size_t n = 0;
+    {
+      MeteredLockGuard<Mutex> l(head_mutex_, head_lock_metrics());
+      Node* const tail = get_tail();  // 只需加一次 tail_mutex_
+      Node* last = nullptr;
+      for (Node* cur = head_.get(); cur != tail && n < max;
+           cur = cur->next.get()) {
+        last = cur;
+        ++n;
+      }
+      if (n == 0) {
+        return 0;
+      }
+      old_head = std::move(head_);
+      head_ = std::move(last->next);  // 从 last 处断开，last 之前的节点被摘下
+    }
+    while (old_head) {  // 在锁外移动元素并逐个释放，避免递归析构
+      *out = std::move(*old_head->v);
+      ++out;
+      old_head = std::move(old_head->next);
+    }
+    return n;
+  }
+
   bool empty() const {
-    std::lock_guard<std::mutex> l(head_mutex_);
+    MeteredLockGuard<Mutex> l(head_mutex_, head_lock_metrics());
     return head_.get() == get_tail();
   }
 
  private:
+  struct Node;
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  struct NodeDeleter {
+    void operator()(Node* p) const noexcept {
+      NodeAllocator a;
+      NodeTraits::destroy(a, p);
+      NodeTraits::deallocate(a, p, 1);
+    }
+  };
+
+  using NodePtr = std::unique_ptr<Node, NodeDeleter>;
+
   struct Node {
     std::shared_ptr<T> v;
-    std::unique_ptr<Node> next;
+    NodePtr next;
   };
 
  private:
-  std::unique_ptr<Node> try_pop_head() {
-    std::lock_guard<std::mutex> l(head_mutex_);
+  NodePtr try_pop_head() {
+    MeteredLockGuard<Mutex> l(head_mutex_, head_lock_metrics());
     if (head_.get() == get_tail()) {
       return nullptr;
     }
     return pop_head();
   }
 
-  std::unique_ptr<Node> try_pop_head(T& res) {
-    std::lock_guard<std::mutex> l(head_mutex_);
+  NodePtr try_pop_head(T& res) {
+    MeteredLockGuard<Mutex> l(head_mutex_, head_lock_metrics());
     if (head_.get() == get_tail()) {
       return nullptr;
     }
@@ -73,38 +176,56 @@ class ConcurrentQueue {
     return pop_head();
   }
 
-  std::unique_ptr<Node> wait_pop_head() {
-    std::unique_lock<std::mutex> l(wait_for_data());
+  NodePtr wait_pop_head() {
+    std::unique_lock<Mutex> l(wait_for_data());
     return pop_head();
   }
 
-  std::unique_ptr<Node> wait_pop_head(T& res) {
-    std::unique_lock<std::mutex> l(wait_for_data());
+  NodePtr wait_pop_head(T& res) {
+    std::unique_lock<Mutex> l(wait_for_data());
     res = std::move(*head_->v);
     return pop_head();
   }
 
-  std::unique_lock<std::mutex> wait_for_data() {
-    std::unique_lock<std::mutex> l(head_mutex_);
+  static NodePtr make_node() {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    NodeTraits::construct(a, p);  // Node 的构造不会抛出异常
+    return NodePtr(p);
+  }
+
+  std::unique_lock<Mutex> wait_for_data() {
+    head_lock_metrics().lock(head_mutex_);
+    std::unique_lock<Mutex> l(head_mutex_, std::adopt_lock);
     cv_.wait(l, [this] { return head_.get() != get_tail(); });
     return l;
   }
 
-  std::unique_ptr<Node> pop_head() {
-    std::unique_ptr<Node> head_node = std::move(head_);
+  NodePtr pop_head() {
+    NodePtr head_node = std::move(head_);
     head_ = std::move(head_node->next);
     return head_node;
   }
 
-  Node* get_tail() {
-    std::lock_guard<std::mutex> l(tail_mutex_);
+  static LockMetrics& head_lock_metrics() {
+    static LockMetrics res("concurrent_queue_lock", "lock=\"head\"");
+    return res;
+  }
+
+  static LockMetrics& tail_lock_metrics() {
+    static LockMetrics res("concurrent_queue_lock", "lock=\"tail\"");
+    return res;
+  }
+
+  Node* get_tail() const {
+    MeteredLockGuard<Mutex> l(tail_mutex_, tail_lock_metrics());
     return tail_;
   }
 
  private:
-  std::unique_ptr<Node> head_;
+  NodePtr head_;
   Node* tail_ = nullptr;
-  std::mutex head_mutex_;
-  mutable std::mutex tail_mutex_;
-  std::condition_variable cv_;
+  mutable Mutex head_mutex_;
+  mutable Mutex tail_mutex_;
+  ConditionVariableFor<Mutex> cv_;
 };
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "reclaimer.hpp"
+
+// 无锁有序表（Herlihy 与 Shavit 的 LockFreeSkipList），
+// 补充无序的 ConcurrentMap，支持 lower_bound 与按键顺序的区间遍历，
+// 查找与修改都是 O(log n)。
+// 每层的 next 与 LockFreeList 一样用最低位作删除标记：删除时从高到低标记节点
+// 每一层的 next，标记第 0 层成功的线程完成删除，之后的 find 帮助逐层摘除。
+// 插入先链入第 0 层（此时插入生效），再逐层向上链入，发现节点已被标记时停止。
+// 读操作不修改链表，跳过已标记的节点。
+// 节点的引用计数初始为 2，分别属于插入者和删除者，最后释放的一方再做一次 find，
+// 保证节点已从所有层摘除，再交给 Reclaimer，避免插入者在删除者摘除后把节点
+// 重新链入高层。键和值插入后不再修改。
+// 各层指针与节点一次分配，第 i 层存放在节点地址之前第 i + 1 个位置，
+// 查找时最常访问的低层指针与 key 相邻
+template <typename K, typename V, typename Compare = std::less<K>,
+          typename Reclaimer = EpochReclaimer>
+class ConcurrentSkipList {
+  static_assert(Reclaimer::ProtectsScope,
+                "traversal needs a reclaimer that protects a whole scope");
+
+ public:
+  // 每层的节点约为下一层的 1 / Branching，MaxHeight 层足以容纳 4^16 个元素
+  static constexpr int MaxHeight = 16;
+  static constexpr unsigned Branching = 4;
+
+  explicit ConcurrentSkipList(const Compare& comp = Compare{}) : comp_(comp) {}
+
+  ~ConcurrentSkipList() {
+    Node* p = pointer(head_[0].load(std::memory_order_relaxed));
+    while (p) {
+      Node* next = pointer(p->next(0).load(std::memory_order_relaxed));
+      destroy_node(p);
+      p = next;
+    }
+  }
+
+  ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+  // 键不存在时用 args 构造值并插入，返回是否插入
+  template <typename... Args>
+  bool emplace(const K& k, Args&&... args) {
+    typename Reclaimer::Guard guard;
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    Node* node = nullptr;
+    for (;;) {
+      if (find(k, preds, succs)) {
+        if (node) {  // 从未发布，直接释放
+          destroy_node(node);
+        }
+        return false;
+      }
+      if (!node) {
+        node = make_node(random_height(), k, std::forward<Args>(args)...);
+        raise_height(node->height);
+      }
+      for (int i = 0; i < node->height; ++i) {
+        node->next(i).store(word(succs[i]), std::memory_order_relaxed);
+      }
+      Word expected = word(succs[0]);
+      if (link(preds[0], 0).compare_exchange_strong(
+              expected, word(node), std::memory_order_release,
+              std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    link_upper_levels(node, preds, succs);
+    release(node);
+    return true;
+  }
+
+  bool insert(const K& k, const V& v) { return emplace(k, v); }
+
+  bool erase(const K& k) {
+    typename Reclaimer::Guard guard;
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    if (!find(k, preds, succs)) {
+      return false;
+    }
+    Node* victim = succs[0];
+    for (int i = victim->height - 1; i > 0; --i) {
+      Word next = victim->next(i).load(std::memory_order_acquire);
+      while (!marked(next) &&
+             !victim->next(i).compare_exchange_weak(
+                 next, next | Mark, std::memory_order_acq_rel,
+                 std::memory_order_acquire)) {
+      }
+    }
+    Word next = victim->next(0).load(std::memory_order_acquire);
+    while (!marked(next)) {
+      if (victim->next(0).compare_exchange_weak(next, next | Mark,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+        release(victim);
+        return true;
+      }
+    }
+    return false;  // 其他线程先删除了它
+  }
+
+  bool contains(const K& k) const {
+    return find_if_present(k, [](const V&) {});
+  }
+
+  // 返回值的副本
+  std::optional<V> get(const K& k) const {
+    std::optional<V> res;
+    find_if_present(k, [&](const V& v) { res.emplace(v); });
+    return res;
+  }
+
+  // 键存在时调用 f(const V&)，避免复制值，返回键是否存在
+  template <typename F>
+  bool find_if_present(const K& k, F f) const {
+    typename Reclaimer::Guard guard;
+    Node* p = lower_bound_node(k);
+    if (!p || comp_(k, p->key)) {
+      return false;
+    }
+    f(std::as_const(p->v));
+    return true;
+  }
+
+  // 返回第一个不小于 k 的元素的副本
+  std::optional<std::pair<K, V>> lower_bound(const K& k) const {
+    typename Reclaimer::Guard guard;
+    Node* p = lower_bound_node(k);
+    if (!p) {
+      return std::nullopt;
+    }
+    return std::pair<K, V>(p->key, p->v);
+  }
+
+  // 按键的顺序对 [lo, hi) 中的元素调用 f(const K&, const V&)，f 返回 void，
+  // 或返回 bool，为 false 时停止。遍历期间不阻塞其他线程的读写，
+  // 开始前已存在且遍历中未被删除的元素恰好访问一次，遍历中插入或删除的元素
+  // 不保证被访问到。整个遍历在同一个 Guard 中，很长的遍历会推迟节点的回收
+  template <typename F>
+  void for_each_in_range(const K& lo, const K& hi, F f) const {
+    typename Reclaimer::Guard guard;
+    for (Node* p = lower_bound_node(lo); p && comp_(p->key, hi);
+         p = next_unmarked(p)) {
+      if (!visit(f, p)) {
+        return;
+      }
+    }
+  }
+
+  template <typename F>
+  void for_each(F f) const {
+    typename Reclaimer::Guard guard;
+    for (Node* p = skip_marked(head_[0].load(std::memory_order_acquire)); p;
+         p = next_unmarked(p)) {
+      if (!visit(f, p)) {
+        return;
+      }
+    }
+  }
+
+ private:
+  using Word = std::uintptr_t;
+
+  static constexpr Word Mark = 1;
+
+  struct Node {
+    const std::uint8_t height;
+    std::atomic<std::uint8_t> refs = 2;
+    const K key;
+    const V v;
+
+    template <typename... Args>
+    Node(int h, const K& k, Args&&... args)
+        : height(static_cast<std::uint8_t>(h)),
+          key(k),
+          v(std::forward<Args>(args)...) {}
+
+    std::atomic<Word>& next(int i) {
+      return reinterpret_cast<std::atomic<Word>*>(this)[-1 - i];
+    }
+  };
+
+  static constexpr std::size_t NodeAlign =
+      std::max(alignof(Node), alignof(std::atomic<Word>));
+
+  // 节点之前存放 height 个指针，向上取整使节点仍然对齐
+  static std::size_t links_size(int height) {
+    const std::size_t n = height * sizeof(std::atomic<Word>);
+    return (n + NodeAlign - 1) / NodeAlign * NodeAlign;
+  }
+
+  template <typename... Args>
+  static Node* make_node(int height, const K& k, Args&&... args) {
+    const std::size_t links = links_size(height);
+    char* base = static_cast<char*>(::operator new(
+        links + sizeof(Node), std::align_val_t(NodeAlign)));
+    Node* p;
+    try {
+      p = new (base + links) Node(height, k, std::forward<Args>(args)...);
+    } catch (...) {
+      ::operator delete(base, std::align_val_t(NodeAlign));
+      throw;
+    }
+    for (int i = 0; i < height; ++i) {
+      new (&p->next(i)) std::atomic<Word>(0);
+    }
+    return p;
+  }
+
+  static void destroy_node(void* q) {
+    Node* p = static_cast<Node*>(q);
+    char* base = reinterpret_cast<char*>(p) - links_size(p->height);
+    p->~Node();
+    ::operator delete(base, std::align_val_t(NodeAlign));
+  }
+
+  static Word word(Node* p) { return reinterpret_cast<Word>(p); }
+
+  static Node* pointer(Word w) { return reinterpret_cast<Node*>(w & ~Mark); }
+
+  static bool marked(Word w) { return w & Mark; }
+
+  static int random_height() {
+    static thread_local std::minstd_rand rng(static_cast<unsigned>(
+        std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    int h = 1;
+    while (h < MaxHeight && rng() % Branching == 0) {
+      ++h;
+    }
+    return h;
+  }
+
+  // pred 为 nullptr 表示头节点
+  std::atomic<Word>& link(Node* pred, int i) {
+    return pred ? pred->next(i) : head_[i];
+  }
+
+  const std::atomic<Word>& link(Node* pred, int i) const {
+    return pred ? pred->next(i) : head_[i];
+  }
+
+  // 只增不减，读到较小的值时只是少用了几层索引
+  void raise_height(int h) {
+    int cur = height_.load(std::memory_order_relaxed);
+    while (cur < h && !height_.compare_exchange_weak(
+                          cur, h, std::memory_order_relaxed)) {
+    }
+  }
+
+  // 在每一层找到 k 的前驱与后继，沿途摘除已标记的节点，
+  // 前驱被删除时从头开始。返回第 0 层的后继是否等于 k
+  bool find(const K& k, Node** preds, Node** succs) {
+  retry:
+    const int top = height_.load(std::memory_order_relaxed);
+    std::fill(succs + top, succs + MaxHeight, nullptr);
+    std::fill(preds + top, preds + MaxHeight, nullptr);
+    Node* pred = nullptr;
+    for (int i = top - 1; i >= 0; --i) {
+      Word cur = link(pred, i).load(std::memory_order_acquire);
+      for (;;) {
+        if (marked(cur)) {  // pred 已被删除
+          goto retry;
+        }
+        Node* p = pointer(cur);
+        if (!p) {
+          break;
+        }
+        const Word next = p->next(i).load(std::memory_order_acquire);
+        if (marked(next)) {
+          if (!link(pred, i).compare_exchange_strong(
+                  cur, next & ~Mark, std::memory_order_acq_rel,
+                  std::memory_order_acquire)) {
+            goto retry;
+          }
+          cur = next & ~Mark;
+          continue;
+        }
+        if (!comp_(p->key, k)) {
+          break;
+        }
+        pred = p;
+        cur = next;
+      }
+      preds[i] = pred;
+      succs[i] = pointer(cur);
+    }
+    return succs[0] && !comp_(k, succs[0]->key);
+  }
+
+  // 节点已在第 0 层，前驱变化时重新 find，节点被删除时停止
+  void link_upper_levels(Node* node, Node** preds, Node** succs) {
+    for (int i = 1; i < node->height; ++i) {
+      for (;;) {
+        Word next = node->next(i).load(std::memory_order_acquire);
+        if (marked(next)) {
+          return;
+        }
+        const Word succ = word(succs[i]);
+        if (next != succ &&
+            !node->next(i).compare_exchange_strong(
+                next, succ, std::memory_order_release,
+                std::memory_order_relaxed)) {
+          return;  // 只有删除者会修改它，一定是被标记了
+        }
+        Word expected = succ;
+        if (link(preds[i], i).compare_exchange_strong(
+                expected, word(node), std::memory_order_release,
+                std::memory_order_relaxed)) {
+          break;
+        }
+        if (!find(node->key, preds, succs) || succs[0] != node) {
+          return;
+        }
+      }
+    }
+  }
+
+  // 插入者和删除者各调用一次，后调用的一方看得到另一方的所有修改，
+  // 此时节点每一层都已标记，find 把它从仍在的层中摘除后即可回收
+  void release(Node* node) {
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    Node* preds[MaxHeight];
+    Node* succs[MaxHeight];
+    find(node->key, preds, succs);
+    Reclaimer::retire(node, &destroy_node);
+  }
+
+  // 第一个不小于 k 且未被删除的节点，不修改链表。已标记的节点不作为前驱：
+  // 它可能早已从低层摘除，沿低层的 next 读到的节点可能已被回收。
+  // 前驱在下降时被标记同样从头开始
+  Node* lower_bound_node(const K& k) const {
+  retry:
+    Node* pred = nullptr;
+    Node* p = nullptr;
+    for (int i = height_.load(std::memory_order_relaxed) - 1; i >= 0; --i) {
+      const Word cur = link(pred, i).load(std::memory_order_acquire);
+      if (marked(cur)) {
+        goto retry;
+      }
+      p = pointer(cur);
+      while (p) {
+        const Word next = p->next(i).load(std::memory_order_acquire);
+        if (!marked(next)) {
+          if (!comp_(p->key, k)) {
+            break;
+          }
+          pred = p;
+        }
+        p = pointer(next);
+      }
+    }
+    return p;
+  }
+
+  static Node* skip_marked(Word w) {
+    Node* p = pointer(w);
+    while (p) {
+      const Word next = p->next(0).load(std::memory_order_acquire);
+      if (!marked(next)) {
+        return p;
+      }
+      p = pointer(next);
+    }
+    return nullptr;
+  }
+
+  static Node* next_unmarked(Node* p) {
+    return skip_marked(p->next(0).load(std::memory_order_acquire));
+  }
+
+  template <typename F>
+  static bool visit(F& f, Node* p) {
+    if constexpr (std::is_same_v<decltype(f(p->key, p->v)), bool>) {
+      return f(std::as_const(p->key), std::as_const(p->v));
+    } else {
+      f(std::as_const(p->key), std::as_const(p->v));
+      return true;
+    }
+  }
+
+ private:
+  Compare comp_;
+  std::atomic<Word> head_[MaxHeight] = {};
+  std::atomic<int> height_ = 1;
+};
@@ -1,57 +1,195 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <random>
 #include <stack>
+#include <thread>
+#include <type_traits>
 #include <utility>
 
+#include "cpu_relax.hpp"
+
 struct EmptyStack : std::exception {
   const char* what() const noexcept { return "empty stack!"; }
 };
 
-template <typename T>
+// 锁被占用时，push 和 pop 先尝试在消除数组中直接配对交换元素，
+// 一对同时发生的 push 与 pop 相当于 push 后立即 pop，无需访问栈本身，
+// 因此竞争越激烈，配对成功的机会越多。配对失败再加锁访问栈。
+// T 的移动操作可能抛异常时不使用消除数组。Mutex 见 lock_policy.hpp
+template <typename T, typename Mutex = std::mutex>
 class ConcurrentStack {
  public:
   ConcurrentStack() = default;
 
   ConcurrentStack(const ConcurrentStack& rhs) {
-    std::lock_guard<std::mutex> l(rhs.m_);
+    std::lock_guard<Mutex> l(rhs.m_);
     s_ = rhs.s_;
   }
 
   ConcurrentStack& operator=(const ConcurrentStack&) = delete;
 
   void push(T x) {
-    std::lock_guard<std::mutex> l(m_);
+    std::unique_lock<Mutex> l(m_, std::try_to_lock);
+    if (!l.owns_lock()) {
+      if constexpr (UseElimination) {
+        if (try_eliminate_push(x)) {
+          return;
+        }
+      }
+      l.lock();
+    }
     s_.push(std::move(x));
   }
 
+  // 加锁一次压入所有元素
+  template <typename InputIt>
+  void push_bulk(InputIt first, InputIt last) {
+    std::lock_guard<Mutex> l(m_);
+    for (; first != last; ++first) {
+      s_.push(*first);
+    }
+  }
+
   bool empty() const {
-    std::lock_guard<std::mutex> l(m_);
+    std::lock_guard<Mutex> l(m_);
     return s_.empty();
   }
 
-  std::shared_ptr<T> pop() {
-    std::lock_guard<std::mutex> l(m_);
+  // 栈为空时返回 std::nullopt，不抛异常
+  std::optional<T> try_pop() {
+    std::unique_lock<Mutex> l(m_, std::try_to_lock);
+    if (!l.owns_lock()) {
+      if constexpr (UseElimination) {
+        if (std::optional<T> res = try_eliminate_pop()) {
+          return res;
+        }
+      }
+      l.lock();
+    }
     if (s_.empty()) {
-      throw EmptyStack();
+      return std::nullopt;
     }
-    auto res = std::make_shared<T>(std::move(s_.top()));
+    std::optional<T> res(std::move(s_.top()));
     s_.pop();
     return res;
   }
 
+  // 加锁一次按出栈顺序取出至多 max 个元素写入 out，返回取出的个数
+  template <typename OutputIt>
+  std::size_t try_pop_bulk(OutputIt out, std::size_t max) {
+    std::lock_guard<Mutex> l(m_);
+    std::size_t n = 0;
+    for (; n < max && !s_.empty(); ++n) {
+      *out = std::move(s_.top());
+      ++out;
+      s_.pop();
+    }
+    return n;
+  }
+
+  std::shared_ptr<T> pop() {
+    std::optional<T> x = try_pop();
+    if (!x) {
+      throw EmptyStack();
+    }
+    return std::make_shared<T>(std::move(*x));
+  }
+
   void pop(T& res) {
-    std::lock_guard<std::mutex> l(m_);
-    if (s_.empty()) {
+    std::optional<T> x = try_pop();
+    if (!x) {
       throw EmptyStack();
     }
-    res = std::move(s_.top());
-    s_.pop();
+    res = std::move(*x);
+  }
+
+ private:
+  static constexpr std::size_t EliminationSlots = 8;
+  static constexpr std::size_t EliminationSpin = 128;  // push 等待配对的次数
+  // 槽位中的元素移动到一半抛出异常时无法恢复状态，因此要求移动不抛异常
+  static constexpr bool UseElimination =
+      std::is_nothrow_move_constructible_v<T> &&
+      std::is_nothrow_move_assignable_v<T>;
+
+  // 槽位状态：push 认领空槽位后写入元素并发布，pop 认领已发布的元素后取走，
+  // 最后由 push 把槽位重置为空
+  enum SlotState : int { Empty, Writing, Offered, Taking, Taken };
+
+  struct alignas(64) Slot {
+    std::atomic<int> state = Empty;
+    std::optional<T> value;
+  };
+
+  // 在随机槽位发布 x 并等待 pop 取走，超时则取回 x 并返回 false
+  bool try_eliminate_push(T& x) {
+    Slot& slot = slots_[random_index()];
+    int expected = Empty;
+    if (!slot.state.compare_exchange_strong(expected, Writing,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+      return false;
+    }
+    slot.value.emplace(std::move(x));
+    slot.state.store(Offered, std::memory_order_release);
+    for (std::size_t i = 0; i < EliminationSpin; ++i) {
+      if (slot.state.load(std::memory_order_acquire) == Taken) {
+        slot.state.store(Empty, std::memory_order_release);
+        return true;
+      }
+      cpu_relax();
+    }
+    expected = Offered;
+    if (slot.state.compare_exchange_strong(expected, Writing,
+                                           std::memory_order_acquire,
+                                           std::memory_order_acquire)) {
+      x = std::move(*slot.value);  // 没有 pop 来取，收回元素
+      slot.value.reset();
+      slot.state.store(Empty, std::memory_order_release);
+      return false;
+    }
+    // pop 已认领元素，等待它取走
+    while (slot.state.load(std::memory_order_acquire) != Taken) {
+      cpu_relax();
+    }
+    slot.state.store(Empty, std::memory_order_release);
+    return true;
+  }
+
+  // 从随机位置开始查找已发布的元素，找不到返回 std::nullopt，不等待
+  std::optional<T> try_eliminate_pop() {
+    const std::size_t first = random_index();
+    for (std::size_t i = 0; i < EliminationSlots; ++i) {
+      Slot& slot = slots_[(first + i) % EliminationSlots];
+      int expected = Offered;
+      if (slot.state.load(std::memory_order_relaxed) == Offered &&
+          slot.state.compare_exchange_strong(expected, Taking,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        std::optional<T> res(std::move(*slot.value));
+        slot.value.reset();
+        slot.state.store(Taken, std::memory_order_release);
+        return res;
+      }
+    }
+    return std::nullopt;
+  }
+
+  static std::size_t random_index() {
+    static thread_local std::minstd_rand rng(static_cast<unsigned>(
+        std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    return rng() % EliminationSlots;
   }
 
  private:
-  mutable std::mutex m_;
+  mutable Mutex m_;
   std::stack<T> s_;
+  std::array<Slot, EliminationSlots> slots_;
 };
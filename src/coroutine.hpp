@@ -0,0 +1,453 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "coroutine.hpp requires C++20 coroutines"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "thread_poll.hpp"
+
+// 基于 C++20 协程的异步接口。Task 是惰性启动的协程，被 co_await 时才开始执行，
+// 结束时直接恢复等待它的协程。AsyncMutex、AsyncLatch 与 AsyncQueue
+// 在条件不满足时挂起协程而不阻塞线程，条件满足后把协程作为任务提交到 Pool，
+// 在工作线程中恢复，不在 unlock、count_down 或 push 的调用者中执行。
+// 这些对象析构前不能有挂起的协程
+
+// 保存协程的结果或异常
+template <typename T>
+class TaskResult {
+ public:
+  void return_value(T v) { v_.template emplace<1>(std::move(v)); }
+
+  void unhandled_exception() noexcept {
+    v_.template emplace<2>(std::current_exception());
+  }
+
+  T get() {
+    if (v_.index() == 2) {
+      std::rethrow_exception(std::get<2>(v_));
+    }
+    return std::move(std::get<1>(v_));
+  }
+
+ private:
+  std::variant<std::monostate, T, std::exception_ptr> v_;
+};
+
+template <>
+class TaskResult<void> {
+ public:
+  void return_void() noexcept {}
+
+  void unhandled_exception() noexcept { e_ = std::current_exception(); }
+
+  void get() {
+    if (e_) {
+      std::rethrow_exception(e_);
+    }
+  }
+
+ private:
+  std::exception_ptr e_;
+};
+
+// co_await std::move(task) 或 co_await f() 启动协程并等待结果，
+// 协程中抛出的异常在 co_await 处重新抛出
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  struct promise_type : TaskResult<T> {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    Task get_return_object() noexcept {
+      return Task(Handle::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // 对称转移，恢复等待者不会增加调用栈的深度
+    auto final_suspend() noexcept {
+      struct Awaiter {
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(Handle h) noexcept {
+          return h.promise().continuation;
+        }
+
+        void await_resume() noexcept {}
+      };
+      return Awaiter{};
+    }
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task(Task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (h_) {
+        h_.destroy();
+      }
+      h_ = std::exchange(other.h_, {});
+    }
+    return *this;
+  }
+
+  ~Task() {
+    if (h_) {
+      h_.destroy();
+    }
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      Handle h;
+
+      bool await_ready() noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> continuation) noexcept {
+        h.promise().continuation = continuation;
+        return h;
+      }
+
+      T await_resume() { return h.promise().get(); }
+    };
+    return Awaiter{h_};
+  }
+
+ private:
+  explicit Task(Handle h) noexcept : h_(h) {}
+
+ private:
+  Handle h_;
+};
+
+// 立即执行、结束时自行销毁的协程，用于 spawn 和 sync_wait
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() noexcept { return {}; }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+
+    std::suspend_never final_suspend() noexcept { return {}; }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+// 在当前线程启动 task，第一次挂起时返回，不等待它结束。
+// 与 ThreadPool::post 一样，task 抛出的异常会导致程序终止
+inline void spawn(Task<> task) {
+  [](Task<> t) -> DetachedTask { co_await std::move(t); }(std::move(task));
+}
+
+// 阻塞当前线程直到 task 结束，返回它的结果。
+// 如果 task 需要在线程池中恢复，不要在唯一的工作线程中调用
+template <typename T>
+T sync_wait(Task<T> task) {
+  struct State {
+    std::mutex m;
+    std::condition_variable cv;
+    bool done = false;
+    TaskResult<T> res;
+  };
+  State s;
+  // 参数存放在协程帧中，lambda 的捕获在协程挂起后就已销毁，不能使用
+  [](Task<T> t, State& s) -> DetachedTask {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(t);
+        s.res.return_void();
+      } else {
+        s.res.return_value(co_await std::move(t));
+      }
+    } catch (...) {
+      s.res.unhandled_exception();
+    }
+    // 持有锁时通知，等待的线程返回并销毁 s 时本协程已不再访问它
+    std::lock_guard<std::mutex> l(s.m);
+    s.done = true;
+    s.cv.notify_one();
+  }(std::move(task), s);
+  std::unique_lock<std::mutex> l(s.m);
+  s.cv.wait(l, [&] { return s.done; });
+  return s.res.get();
+}
+
+// 挂起的协程组成的侵入式 FIFO 链表。节点是 awaiter 自身，
+// 位于挂起的协程帧中，协程恢复前一直有效
+template <typename Waiter>
+class WaiterList {
+ public:
+  bool empty() const noexcept { return head_ == nullptr; }
+
+  void push_back(Waiter* w) noexcept {
+    w->next = nullptr;
+    (head_ ? tail_->next : head_) = w;
+    tail_ = w;
+  }
+
+  Waiter* pop_front() noexcept {
+    Waiter* w = head_;
+    if (w) {
+      head_ = w->next;
+    }
+    return w;
+  }
+
+  // 取出整条链表，沿 next 遍历
+  Waiter* take_all() noexcept { return std::exchange(head_, nullptr); }
+
+ private:
+  Waiter* head_ = nullptr;
+  Waiter* tail_ = nullptr;
+};
+
+// 在 pool 的工作线程中恢复 h，线程池已关闭时在当前线程恢复
+template <typename Pool>
+void resume_on(Pool& pool, std::coroutine_handle<> h) {
+  try {
+    pool.post([h] { h.resume(); });
+  } catch (...) {
+    h.resume();
+  }
+}
+
+template <typename AsyncMutex>
+class AsyncLockGuard {
+ public:
+  explicit AsyncLockGuard(AsyncMutex& m, std::adopt_lock_t) noexcept
+      : m_(&m) {}
+
+  AsyncLockGuard(AsyncLockGuard&& other) noexcept
+      : m_(std::exchange(other.m_, nullptr)) {}
+
+  AsyncLockGuard& operator=(AsyncLockGuard&&) = delete;
+
+  ~AsyncLockGuard() {
+    if (m_) {
+      m_->unlock();
+    }
+  }
+
+ private:
+  AsyncMutex* m_;
+};
+
+// co_await m.lock() 或 auto l = co_await m.scoped_lock()。
+// 解锁时锁直接交给最早挂起的协程，按 FIFO 顺序获得锁，
+// 因此持有锁时可以 co_await，挂起期间不占用任何线程。
+// Mutex 只保护状态和链表，临界区只有几条指令
+template <typename Pool = ThreadPool, typename Mutex = std::mutex>
+class AsyncMutex {
+  struct LockAwaiter {
+    AsyncMutex& m;
+    std::coroutine_handle<> h = nullptr;
+    LockAwaiter* next = nullptr;
+
+    bool await_ready() { return m.try_lock(); }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      h = handle;
+      std::lock_guard<Mutex> l(m.m_);
+      if (!m.locked_) {
+        m.locked_ = true;
+        return false;
+      }
+      m.waiters_.push_back(this);
+      return true;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  struct ScopedLockAwaiter : LockAwaiter {
+    AsyncLockGuard<AsyncMutex> await_resume() const noexcept {
+      return AsyncLockGuard<AsyncMutex>(this->m, std::adopt_lock);
+    }
+  };
+
+ public:
+  explicit AsyncMutex(Pool& pool) : pool_(pool) {}
+
+  AsyncMutex(const AsyncMutex&) = delete;
+
+  AsyncMutex& operator=(const AsyncMutex&) = delete;
+
+  LockAwaiter lock() noexcept { return LockAwaiter{*this}; }
+
+  ScopedLockAwaiter scoped_lock() noexcept {
+    return ScopedLockAwaiter{{*this}};
+  }
+
+  bool try_lock() {
+    std::lock_guard<Mutex> l(m_);
+    return !std::exchange(locked_, true);
+  }
+
+  void unlock() {
+    LockAwaiter* next;
+    {
+      std::lock_guard<Mutex> l(m_);
+      next = waiters_.pop_front();
+      locked_ = next != nullptr;
+    }
+    if (next) {
+      resume_on(pool_, next->h);
+    }
+  }
+
+ private:
+  Pool& pool_;
+  Mutex m_;
+  bool locked_ = false;
+  WaiterList<LockAwaiter> waiters_;
+};
+
+// 与 std::latch 相同，计数减到 0 后 co_await wait() 不再挂起
+template <typename Pool = ThreadPool, typename Mutex = std::mutex>
+class AsyncLatch {
+  struct WaitAwaiter {
+    AsyncLatch& latch;
+    std::coroutine_handle<> h = nullptr;
+    WaitAwaiter* next = nullptr;
+
+    bool await_ready() const { return latch.try_wait(); }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      h = handle;
+      std::lock_guard<Mutex> l(latch.m_);
+      if (latch.count_ == 0) {
+        return false;
+      }
+      latch.waiters_.push_back(this);
+      return true;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+ public:
+  AsyncLatch(Pool& pool, std::ptrdiff_t count) : pool_(pool), count_(count) {}
+
+  AsyncLatch(const AsyncLatch&) = delete;
+
+  AsyncLatch& operator=(const AsyncLatch&) = delete;
+
+  void count_down(std::ptrdiff_t n = 1) {
+    WaitAwaiter* w;
+    {
+      std::lock_guard<Mutex> l(m_);
+      count_ -= n;
+      if (count_ != 0) {
+        return;
+      }
+      w = waiters_.take_all();
+    }
+    // 第一个等待者恢复后可能立即销毁本对象，之后只使用局部变量；
+    // 同理恢复后 w 所在的协程帧可能已被销毁
+    Pool& pool = pool_;
+    while (w) {
+      WaitAwaiter* next = w->next;
+      resume_on(pool, w->h);
+      w = next;
+    }
+  }
+
+  bool try_wait() const {
+    std::lock_guard<Mutex> l(m_);
+    return count_ == 0;
+  }
+
+  WaitAwaiter wait() noexcept { return WaitAwaiter{*this}; }
+
+ private:
+  Pool& pool_;
+  mutable Mutex m_;
+  std::ptrdiff_t count_;
+  WaiterList<WaitAwaiter> waiters_;
+};
+
+// 无界队列，co_await q.pop() 在队列为空时挂起。
+// push 遇到挂起的消费者时把元素直接交给最早挂起的一个，不进入队列
+template <typename T, typename Pool = ThreadPool, typename Mutex = std::mutex>
+class AsyncQueue {
+  struct PopAwaiter {
+    AsyncQueue& q;
+    std::coroutine_handle<> h = nullptr;
+    PopAwaiter* next = nullptr;
+    std::optional<T> v = std::nullopt;
+
+    bool await_ready() {
+      v = q.try_pop();
+      return v.has_value();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      h = handle;
+      std::lock_guard<Mutex> l(q.m_);
+      if (!q.q_.empty()) {
+        v.emplace(std::move(q.q_.front()));
+        q.q_.pop_front();
+        return false;
+      }
+      q.waiters_.push_back(this);
+      return true;
+    }
+
+    T await_resume() { return std::move(*v); }
+  };
+
+ public:
+  explicit AsyncQueue(Pool& pool) : pool_(pool) {}
+
+  AsyncQueue(const AsyncQueue&) = delete;
+
+  AsyncQueue& operator=(const AsyncQueue&) = delete;
+
+  void push(T x) {
+    PopAwaiter* w;
+    {
+      std::lock_guard<Mutex> l(m_);
+      w = waiters_.pop_front();
+      if (!w) {
+        q_.push_back(std::move(x));
+        return;
+      }
+      w->v.emplace(std::move(x));
+    }
+    resume_on(pool_, w->h);
+  }
+
+  std::optional<T> try_pop() {
+    std::lock_guard<Mutex> l(m_);
+    if (q_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> res(std::move(q_.front()));
+    q_.pop_front();
+    return res;
+  }
+
+  PopAwaiter pop() noexcept { return PopAwaiter{*this}; }
+
+ private:
+  Pool& pool_;
+  Mutex m_;
+  std::deque<T> q_;
+  WaiterList<PopAwaiter> waiters_;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// NUMA 节点与 CPU 的对应关系，Linux 上读取 /sys/devices/system/node，
+// 其他平台或读取失败时视为只有一个节点
+class CpuTopology {
+ public:
+  static CpuTopology detect() {
+    CpuTopology res;
+    const std::vector<int> allowed = allowed_cpus();
+#if defined(__linux__)
+    for (std::size_t node = 0;; ++node) {
+      std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) +
+                      "/cpulist");
+      if (!f) {
+        break;
+      }
+      std::string s;
+      std::getline(f, s);
+      std::vector<int> cpus;
+      for (int cpu : parse_cpu_list(s)) {  // 只保留当前进程允许使用的 CPU
+        for (int x : allowed) {
+          if (x == cpu) {
+            cpus.emplace_back(cpu);
+            break;
+          }
+        }
+      }
+      if (!cpus.empty()) {
+        res.nodes_.emplace_back(std::move(cpus));
+      }
+    }
+#endif
+    if (res.nodes_.empty()) {
+      res.nodes_.emplace_back(allowed);
+    }
+    return res;
+  }
+
+  std::size_t node_count() const { return nodes_.size(); }
+
+  const std::vector<int>& cpus_of_node(std::size_t node) const {
+    return nodes_[node];
+  }
+
+  // 把当前线程绑定到给定的 CPU 集合，不支持的平台返回 false
+  static bool pin_this_thread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+  }
+
+ private:
+  static std::vector<int> allowed_cpus() {
+    std::vector<int> res;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int i = 0; i < CPU_SETSIZE; ++i) {
+        if (CPU_ISSET(i, &set)) {
+          res.emplace_back(i);
+        }
+      }
+    }
+#endif
+    if (res.empty()) {
+      const int n = static_cast<int>(std::thread::hardware_concurrency());
+      for (int i = 0; i < std::max(n, 1); ++i) {
+        res.emplace_back(i);
+      }
+    }
+    return res;
+  }
+
+  // 解析形如 "0-3,8-11" 的列表
+  static std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> res;
+    std::istringstream is(s);
+    std::string range;
+    while (std::getline(is, range, ',')) {
+      if (range.empty()) {
+        continue;
+      }
+      const std::size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash));
+      const int last =
+          dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int i = first; i <= last; ++i) {
+        res.emplace_back(i);
+      }
+    }
+    return res;
+  }
+
+ private:
+  std::vector<std::vector<int>> nodes_;
+};
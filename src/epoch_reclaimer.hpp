@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "asymmetric_fence.hpp"
+#include "metrics.hpp"
+
+// 基于纪元的回收（EBR）。全局纪元单调递增，线程进入临界区时把当前纪元
+// 写入自己的记录，退出时清零。被摘除的节点记下摘除时的纪元 e，
+// 全局纪元推进到 e + 2 后，所有可能看到该节点的临界区都已退出，可以释放。
+// 只有所有处于临界区的线程都已观察到当前纪元时，纪元才能推进一步，
+// 因此一个长期停留在临界区的线程会阻止所有节点的释放。
+// 进入临界区只需一次 relaxed 写和编译器屏障，见 asymmetric_fence.hpp，
+// 每次访问的开销远低于风险指针，也不需要逐个保护读到的指针
+class EpochDomain {
+ public:
+  // 不在进程退出时析构：deleter 可能用到其他静态对象，如节点所在的
+  // 内存池，它们可能先于域析构。未释放的节点随进程一起回收
+  static EpochDomain& instance() {
+    static EpochDomain* res = new EpochDomain;
+    return *res;
+  }
+
+  EpochDomain(const EpochDomain&) = delete;
+
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // 可以嵌套，只有最外层的 enter 和 leave 生效
+  void enter() {
+    ThreadData& d = local();
+    if (d.nesting++ == 0) {
+      const std::uint64_t e = epoch_.load(std::memory_order_relaxed);
+      d.record->state.store(e << 1 | 1, std::memory_order_relaxed);
+      asymmetric_light_fence();  // 与推进纪元一侧的 heavy fence 配对
+    }
+  }
+
+  void leave() {
+    ThreadData& d = local();
+    if (--d.nesting == 0) {
+      d.record->state.store(0, std::memory_order_release);
+    }
+  }
+
+  // p 已从数据结构中摘除，两个纪元后调用 deleter(p)
+  void retire(void* p, void (*deleter)(void*)) {
+    ThreadData& d = local();
+    // 读纪元不能早于摘除 p，否则可能读到旧的纪元 e，而持有 p 的读者
+    // 已进入 e + 1，推进到 e + 2 时不会等待它。retire 不是热路径
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    d.retired.push_back(
+        Retired{p, deleter, epoch_.load(std::memory_order_relaxed)});
+    retired_counter().add();
+    if (d.retired.size() >= CollectThreshold) {
+      collect(d.retired);
+    }
+  }
+
+ private:
+  // 每次进入临界区都会写记录，按缓存行对齐避免伪共享
+  struct alignas(64) Record {
+    // 处于临界区时为 (纪元 << 1) | 1，否则为 0
+    std::atomic<std::uint64_t> state = 0;
+    std::atomic<bool> active = false;
+    Record* next = nullptr;
+  };
+
+  struct Retired {
+    void* p;
+    void (*deleter)(void*);
+    std::uint64_t epoch;
+  };
+
+  struct ThreadData {
+    Record* record = instance().acquire_record();
+    std::size_t nesting = 0;
+    std::vector<Retired> retired;  // 按纪元非递减排列
+
+    ~ThreadData() {
+      EpochDomain& domain = instance();
+      record->active.store(false, std::memory_order_release);
+      if (!retired.empty()) {
+        domain.collect(retired);
+      }
+      if (!retired.empty()) {  // 尚未到期的节点交给之后回收的线程
+        std::lock_guard<std::mutex> l(domain.orphans_m_);
+        domain.orphans_.insert(domain.orphans_.end(), retired.begin(),
+                               retired.end());
+        domain.has_orphans_.store(true, std::memory_order_release);
+      }
+    }
+  };
+
+  static constexpr std::size_t CollectThreshold = 64;
+
+  EpochDomain() = default;
+
+  static ThreadData& local() {
+    static thread_local ThreadData res;
+    return res;
+  }
+
+  // 认领已退出线程留下的记录，没有时新建
+  Record* acquire_record() {
+    for (Record* r = records_.load(std::memory_order_acquire); r;
+         r = r->next) {
+      bool expected = false;
+      if (!r->active.load(std::memory_order_relaxed) &&
+          r->active.compare_exchange_strong(expected, true,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+        return r;
+      }
+    }
+    Record* r = new Record;
+    r->active.store(true, std::memory_order_relaxed);
+    r->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(r->next, r,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    return r;
+  }
+
+  // 两者之差为尚未释放的节点数，见 metrics.hpp
+  static ShardedCounter& retired_counter() {
+    static ShardedCounter res("epoch_retired_total");
+    return res;
+  }
+
+  static ShardedCounter& reclaimed_counter() {
+    static ShardedCounter res("epoch_reclaimed_total");
+    return res;
+  }
+
+  // 所有处于临界区的线程都已观察到当前纪元时推进一步，返回推进后的纪元
+  std::uint64_t try_advance() {
+    std::uint64_t e = epoch_.load(std::memory_order_relaxed);
+    asymmetric_heavy_fence();  // 保证读者写入的纪元在下面的读取中可见
+    for (Record* r = records_.load(std::memory_order_acquire); r;
+         r = r->next) {
+      const std::uint64_t s = r->state.load(std::memory_order_acquire);
+      if ((s & 1) && s >> 1 != e) {
+        return e;
+      }
+    }
+    // 失败说明其他线程已推进，结果同样可用
+    epoch_.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel,
+                                   std::memory_order_relaxed);
+    return epoch_.load(std::memory_order_relaxed);
+  }
+
+  void collect(std::vector<Retired>& retired) {
+    const std::uint64_t e = try_advance();
+    auto expired = [e](const Retired& x) { return x.epoch + 2 <= e; };
+    std::vector<Retired> to_delete;
+    if (has_orphans_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> l(orphans_m_);
+      auto kept = std::stable_partition(
+          orphans_.begin(), orphans_.end(),
+          [&](const Retired& x) { return !expired(x); });
+      to_delete.assign(kept, orphans_.end());
+      orphans_.erase(kept, orphans_.end());
+      has_orphans_.store(!orphans_.empty(), std::memory_order_relaxed);
+    }
+    auto last = std::find_if_not(retired.begin(), retired.end(), expired);
+    to_delete.insert(to_delete.end(), retired.begin(), last);
+    retired.erase(retired.begin(), last);
+    reclaimed_counter().add(to_delete.size());
+    for (Retired& x : to_delete) {  // deleter 可能再次调用 retire
+      x.deleter(x.p);
+    }
+  }
+
+ private:
+  std::atomic<std::uint64_t> epoch_ = 0;
+  std::atomic<Record*> records_ = nullptr;
+  std::mutex orphans_m_;
+  std::vector<Retired> orphans_;  // 已退出线程留下的待删除节点
+  std::atomic<bool> has_orphans_ = false;
+};
+
+// 在作用域内处于 EBR 临界区，期间读到的节点不会被释放
+class EpochGuard {
+ public:
+  EpochGuard() { EpochDomain::instance().enter(); }
+
+  ~EpochGuard() { EpochDomain::instance().leave(); }
+
+  EpochGuard(const EpochGuard&) = delete;
+
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+  // 临界区保护所有读到的节点，直接读取即可
+  template <typename U>
+  U* protect(const std::atomic<U*>& src) {
+    return src.load(std::memory_order_acquire);
+  }
+
+  void reset() {}
+};
+
+// 基于纪元的回收器，接口见 reclaimer.hpp
+struct EpochReclaimer {
+  using Guard = EpochGuard;
+
+  static constexpr bool ProtectsScope = true;
+
+  static void retire(void* p, void (*deleter)(void*)) {
+    EpochDomain::instance().retire(p, deleter);
+  }
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_BUCKET_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "bit_ops.hpp"
+#include "seq_shared_mutex.hpp"
+
+// ConcurrentMap 的开放寻址桶，布局类似 Swiss table：
+// 每组 16 个槽位连续存放，另用 16 个控制字节记录槽位是否为空及哈希值的 7 位，
+// 查找时用一次 SIMD 比较筛出候选槽位，只对候选槽位比较键。
+// 一组放满后链接一个溢出组，溢出组在桶析构前不会释放。
+// 元素直接构造在槽位中，插入时不再为每个元素分配内存。
+// 组一旦分配就不会释放，K 和 V 可平凡复制时 get 可以不加锁，
+// 读到的数据由序号检验，见 SeqSharedMutex
+template <typename K, typename V>
+class FlatBucket {
+ public:
+  // 平均每个桶的元素数超过它时扩容，即首组约 3/4 满
+  static constexpr std::size_t MaxLoad = 12;
+  static constexpr bool OptimisticRead =
+      std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>;
+
+  using Mutex = SeqSharedMutex;
+
+  mutable Mutex m;  // 保护整组槽位
+  bool migrated = false;        // 元素已全部迁移到新表，不再使用
+
+  FlatBucket() = default;
+
+  FlatBucket(const FlatBucket&) = delete;
+
+  FlatBucket& operator=(const FlatBucket&) = delete;
+
+  // 以下函数均要求调用者持有 m，Q 为 K 或透明哈希下可与 K 比较的类型
+  template <typename Q>
+  const V* find(const Q& k, std::size_t h) const {
+    const Slot* s = find_slot(k, h);
+    return s ? &s->second : nullptr;
+  }
+
+  template <typename Q>
+  V* find(const Q& k, std::size_t h) {
+    return const_cast<V*>(std::as_const(*this).find(k, h));
+  }
+
+  // 不持有锁时调用，结果可能与写者交错，需由调用者检验序号后才能使用
+  template <typename Q>
+  bool get_unlocked(const Q& k, std::size_t h, V& res) const {
+    static_assert(OptimisticRead, "K and V must be trivially copyable");
+    const Slot* s = find_slot(k, h);
+    if (!s) {
+      return false;
+    }
+    res = s->second;
+    return true;
+  }
+
+  // 调用者保证 k 不存在，用 args 构造值放入第一个空槽位，所有组都满时新建溢出组
+  template <typename KeyArg, typename... Args>
+  V& insert_new(KeyArg&& k, std::size_t h, Args&&... args) {
+    const auto [g, i] = emplace(std::forward<KeyArg>(k), h,
+                                std::forward<Args>(args)...);
+    return g->slot(i)->second;
+  }
+
+  template <typename Q>
+  bool erase(const Q& k, std::size_t h) {
+    const std::int8_t tag = tag_of(h);
+    for (Group* g = &head_; g; g = g->next.load(std::memory_order_relaxed)) {
+      for (unsigned mask = g->match(tag); mask; mask &= mask - 1) {
+        const int i = lowest_bit(mask);
+        if (g->slot(i)->first == k) {
+          g->destroy(i);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  template <typename F>
+  void for_each(F&& f) const {
+    for (const Group* g = &head_; g;
+         g = g->next.load(std::memory_order_relaxed)) {
+      for (unsigned mask = g->match_full(); mask; mask &= mask - 1) {
+        const Slot* s = g->slot(lowest_bit(mask));
+        f(s->first, s->second);
+      }
+    }
+  }
+
+  // 把所有元素移动到 sink(哈希值) 返回的桶中，每次移动前对目标桶加锁。
+  // 强异常安全：先算出所有哈希值，之后只有新建溢出组可能抛异常，
+  // 此时把已移出的元素移回原槽位
+  template <typename HashFn, typename Sink>
+  void migrate(const HashFn& hash, Sink&& sink) {
+    static_assert(std::is_nothrow_move_constructible_v<K> &&
+                      std::is_nothrow_move_constructible_v<V>,
+                  "K and V must be nothrow move constructible");
+    struct Moved {
+      std::size_t h;
+      Group* from;
+      int from_i;
+      FlatBucket* to = nullptr;
+      Group* g = nullptr;
+      int i = 0;
+    };
+    std::vector<Moved> moved;
+    for (Group* g = &head_; g; g = g->next.load(std::memory_order_relaxed)) {
+      for (unsigned mask = g->match_full(); mask; mask &= mask - 1) {
+        const int i = lowest_bit(mask);
+        moved.push_back({hash(g->slot(i)->first), g, i});
+      }
+    }
+    std::size_t n = 0;
+    try {
+      for (; n < moved.size(); ++n) {
+        Moved& x = moved[n];
+        FlatBucket& b = sink(x.h);
+        std::unique_lock<Mutex> l(b.m);
+        Slot* s = x.from->slot(x.from_i);
+        std::tie(x.g, x.i) =
+            b.emplace(std::move(s->first), x.h, std::move(s->second));
+        x.to = &b;
+        x.from->destroy(x.from_i);
+      }
+    } catch (...) {
+      for (std::size_t j = 0; j < n; ++j) {
+        const Moved& x = moved[j];
+        std::unique_lock<Mutex> l(x.to->m);
+        relocate(*x.g, x.i, *x.from, x.from_i);
+      }
+      throw;
+    }
+  }
+
+ private:
+  static constexpr std::size_t GroupSize = 16;
+  static constexpr std::int8_t Empty = -128;  // 满槽位的控制字节在 [0, 127]
+
+  using Slot = std::pair<K, V>;
+
+  struct Group {
+    Group() { std::memset(ctrl, Empty, sizeof(ctrl)); }
+
+    ~Group() {
+      for (unsigned mask = match_full(); mask; mask &= mask - 1) {
+        destroy(lowest_bit(mask));
+      }
+      delete next.load(std::memory_order_relaxed);
+    }
+
+    Slot* slot(int i) {
+      return std::launder(reinterpret_cast<Slot*>(slots + i * sizeof(Slot)));
+    }
+
+    const Slot* slot(int i) const {
+      return std::launder(
+          reinterpret_cast<const Slot*>(slots + i * sizeof(Slot)));
+    }
+
+    void destroy(int i) {
+      slot(i)->~Slot();
+      ctrl[i] = Empty;
+    }
+
+    // 返回控制字节等于 tag 的槽位掩码
+    unsigned match(std::int8_t tag) const {
+#ifdef FLAT_BUCKET_SSE2
+      const __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+      return static_cast<unsigned>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(tag))));
+#else
+      unsigned res = 0;
+      for (std::size_t i = 0; i < GroupSize; ++i) {
+        res |= static_cast<unsigned>(ctrl[i] == tag) << i;
+      }
+      return res;
+#endif
+    }
+
+    // 满槽位的控制字节最高位为 0
+    unsigned match_full() const {
+#ifdef FLAT_BUCKET_SSE2
+      const __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+      return ~static_cast<unsigned>(_mm_movemask_epi8(c)) & 0xFFFF;
+#else
+      unsigned res = 0;
+      for (std::size_t i = 0; i < GroupSize; ++i) {
+        res |= static_cast<unsigned>(ctrl[i] >= 0) << i;
+      }
+      return res;
+#endif
+    }
+
+    alignas(16) std::int8_t ctrl[GroupSize];
+    alignas(Slot) unsigned char slots[GroupSize * sizeof(Slot)];
+    // 组归所在的桶所有，随前一个组析构。不加锁的读者也会沿它遍历，
+    // 新组构造完成后以 release 发布，find_slot 以 acquire 读取
+    std::atomic<Group*> next = nullptr;
+  };
+
+  // 桶索引由哈希值取模得到，这里先混合再取高 7 位，使同一桶内的 tag 分布均匀
+  static std::int8_t tag_of(std::size_t h) {
+    return static_cast<std::int8_t>(
+        (static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull) >> 57);
+  }
+
+  // 在第一个空槽位构造元素，所有组都满时新建溢出组，返回元素所在的位置
+  template <typename KeyArg, typename... Args>
+  std::pair<Group*, int> emplace(KeyArg&& k, std::size_t h, Args&&... args) {
+    Group* g = &head_;
+    unsigned mask = g->match(Empty);
+    while (!mask) {
+      Group* next = g->next.load(std::memory_order_relaxed);
+      if (!next) {
+        next = new Group;
+        g->next.store(next, std::memory_order_release);
+      }
+      g = next;
+      mask = g->match(Empty);
+    }
+    const int i = lowest_bit(mask);
+    ::new (static_cast<void*>(g->slots + i * sizeof(Slot)))
+        Slot(std::piecewise_construct,
+             std::forward_as_tuple(std::forward<KeyArg>(k)),
+             std::forward_as_tuple(std::forward<Args>(args)...));
+    g->ctrl[i] = tag_of(h);  // 构造成功后才标记为满，构造抛异常时槽位仍为空
+    return {g, i};
+  }
+
+  // 把 from 的槽位 i 中的元素移动到 to 的空槽位 j，不会抛异常
+  static void relocate(Group& from, int i, Group& to, int j) {
+    ::new (static_cast<void*>(to.slots + j * sizeof(Slot)))
+        Slot(std::move(*from.slot(i)));
+    to.ctrl[j] = from.ctrl[i];
+    from.destroy(i);
+  }
+
+  template <typename Q>
+  const Slot* find_slot(const Q& k, std::size_t h) const {
+    const std::int8_t tag = tag_of(h);
+    for (const Group* g = &head_; g;
+         g = g->next.load(std::memory_order_acquire)) {
+      for (unsigned mask = g->match(tag); mask; mask &= mask - 1) {
+        const Slot* s = g->slot(lowest_bit(mask));
+        if (s->first == k) {
+          return s;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  Group head_;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// std::function 要求可调用对象可拷贝，无法存储 std::packaged_task，
+// 因此实现一个 move-only 的类型擦除包裹类。
+// 小对象（如 std::packaged_task）直接构造在内部缓冲区中，不额外分配内存
+class FunctionWrapper {
+ public:
+  FunctionWrapper() = default;
+
+  FunctionWrapper(const FunctionWrapper&) = delete;
+
+  FunctionWrapper& operator=(const FunctionWrapper&) = delete;
+
+  FunctionWrapper(FunctionWrapper&& rhs) noexcept { move_from(rhs); }
+
+  FunctionWrapper& operator=(FunctionWrapper&& rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      move_from(rhs);
+    }
+    return *this;
+  }
+
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<
+                            std::decay_t<F>, FunctionWrapper>>>
+  FunctionWrapper(F&& f) {
+    using Fn = std::decay_t<F>;
+    if constexpr (fits_inline<Fn>()) {
+      ::new (static_cast<void*>(buf_)) Fn(std::forward<F>(f));
+      ops_ = &inline_ops<Fn>;
+    } else {
+      ::new (static_cast<void*>(buf_)) Fn*(new Fn(std::forward<F>(f)));
+      ops_ = &heap_ops<Fn>;
+    }
+  }
+
+  ~FunctionWrapper() { reset(); }
+
+  void operator()() { ops_->call(buf_); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(buf_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  static constexpr std::size_t BufferSize = 3 * sizeof(void*);
+
+  struct Ops {
+    void (*call)(void*);
+    void (*move)(void* dst, void* src) noexcept;  // 移动到 dst 并析构 src
+    void (*destroy)(void*) noexcept;
+  };
+
+  template <typename Fn>
+  static constexpr bool fits_inline() {
+    return sizeof(Fn) <= BufferSize &&
+           alignof(std::max_align_t) % alignof(Fn) == 0 &&
+           std::is_nothrow_move_constructible_v<Fn>;
+  }
+
+  template <typename Fn>
+  static constexpr Ops inline_ops{
+      [](void* p) { (*static_cast<Fn*>(p))(); },
+      [](void* dst, void* src) noexcept {
+        ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+        static_cast<Fn*>(src)->~Fn();
+      },
+      [](void* p) noexcept { static_cast<Fn*>(p)->~Fn(); }};
+
+  template <typename Fn>
+  static constexpr Ops heap_ops{
+      [](void* p) { (**static_cast<Fn**>(p))(); },
+      [](void* dst, void* src) noexcept {
+        ::new (dst) Fn*(*static_cast<Fn**>(src));
+      },
+      [](void* p) noexcept { delete *static_cast<Fn**>(p); }};
+
+  void move_from(FunctionWrapper& rhs) noexcept {
+    if (rhs.ops_) {
+      rhs.ops_->move(buf_, rhs.buf_);
+      ops_ = rhs.ops_;
+      rhs.ops_ = nullptr;
+    }
+  }
+
+ private:
+  alignas(std::max_align_t) unsigned char buf_[BufferSize];
+  const Ops* ops_ = nullptr;
+};
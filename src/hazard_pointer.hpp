@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "asymmetric_fence.hpp"
+#include "metrics.hpp"
+
+// 风险指针域。风险指针记录串成一个只增不减的无锁链表，数量随线程数增长，
+// 线程退出后记录标记为空闲供新线程复用，因此不限制线程数。
+// 每个线程有自己的待删除列表，累计 R = 2H（H 为记录数，至少 64）个节点后
+// 才扫描一次：取所有风险指针的快照排序，再逐个二分查找待删除节点，
+// 未被引用的节点立即释放，平均每次删除的开销为 O(log H)。
+// 写风险指针与扫描之间使用非对称屏障，读者一侧只需编译器屏障，
+// 见 asymmetric_fence.hpp
+class HazardPointerDomain {
+ public:
+  struct Record {
+    std::atomic<const void*> p = nullptr;
+    std::atomic<bool> active = false;
+    Record* next = nullptr;
+  };
+
+  // 不在进程退出时析构：deleter 可能用到其他静态对象，如节点所在的
+  // 内存池，它们可能先于域析构。未释放的节点随进程一起回收
+  static HazardPointerDomain& instance() {
+    static HazardPointerDomain* res = new HazardPointerDomain;
+    return *res;
+  }
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  // 从本线程缓存的记录中取一个，没有时从全局链表认领或新建
+  Record* acquire() {
+    ThreadData& d = local();
+    if (!d.records.empty()) {
+      Record* r = d.records.back();
+      d.records.pop_back();
+      return r;
+    }
+    return acquire_global();
+  }
+
+  void release(Record* r) {
+    r->p.store(nullptr, std::memory_order_release);
+    local().records.emplace_back(r);
+  }
+
+  // p 已从数据结构中摘除，不再被引用时调用 deleter(p)
+  void retire(void* p, void (*deleter)(void*)) {
+    ThreadData& d = local();
+    d.retired.push_back(Retired{p, deleter});
+    retired_counter().add();
+    if (d.retired.size() >= scan_threshold()) {
+      scan(d.retired);
+    }
+  }
+
+ private:
+  struct Retired {
+    void* p;
+    void (*deleter)(void*);
+  };
+
+  struct ThreadData {
+    std::vector<Record*> records;  // 本线程持有但未使用的记录
+    std::vector<Retired> retired;
+
+    ~ThreadData() {
+      HazardPointerDomain& domain = instance();
+      for (Record* r : records) {
+        r->active.store(false, std::memory_order_release);
+      }
+      if (!retired.empty()) {
+        domain.scan(retired);
+      }
+      if (!retired.empty()) {  // 仍被引用的节点交给之后扫描的线程
+        std::lock_guard<std::mutex> l(domain.orphans_m_);
+        domain.orphans_.insert(domain.orphans_.end(), retired.begin(),
+                               retired.end());
+        domain.has_orphans_.store(true, std::memory_order_release);
+      }
+    }
+  };
+
+  static constexpr std::size_t MinScanThreshold = 64;
+
+  HazardPointerDomain() = default;
+
+  static ThreadData& local() {
+    static thread_local ThreadData res;
+    return res;
+  }
+
+  Record* acquire_global() {
+    for (Record* r = records_.load(std::memory_order_acquire); r;
+         r = r->next) {
+      bool expected = false;
+      if (!r->active.load(std::memory_order_relaxed) &&
+          r->active.compare_exchange_strong(expected, true,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+        return r;
+      }
+    }
+    Record* r = new Record;
+    r->active.store(true, std::memory_order_relaxed);
+    r->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(r->next, r,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    record_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return r;
+  }
+
+  // 两者之差为尚未释放的节点数，见 metrics.hpp
+  static ShardedCounter& retired_counter() {
+    static ShardedCounter res("hazard_pointer_retired_total");
+    return res;
+  }
+
+  static ShardedCounter& reclaimed_counter() {
+    static ShardedCounter res("hazard_pointer_reclaimed_total");
+    return res;
+  }
+
+  std::size_t scan_threshold() const {
+    return std::max(MinScanThreshold,
+                    2 * record_cnt_.load(std::memory_order_relaxed));
+  }
+
+  void scan(std::vector<Retired>& retired) {
+    if (has_orphans_.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> l(orphans_m_);
+      retired.insert(retired.end(), orphans_.begin(), orphans_.end());
+      orphans_.clear();
+      has_orphans_.store(false, std::memory_order_relaxed);
+    }
+    asymmetric_heavy_fence();  // 保证读者写入的风险指针在下面的读取中可见
+    std::vector<const void*> hazards;
+    hazards.reserve(record_cnt_.load(std::memory_order_relaxed));
+    for (Record* r = records_.load(std::memory_order_acquire); r;
+         r = r->next) {
+      if (const void* p = r->p.load(std::memory_order_acquire)) {
+        hazards.emplace_back(p);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+    auto kept = std::partition(retired.begin(), retired.end(), [&](auto& x) {
+      return std::binary_search(hazards.begin(), hazards.end(), x.p);
+    });
+    std::vector<Retired> to_delete(kept, retired.end());
+    retired.erase(kept, retired.end());
+    reclaimed_counter().add(to_delete.size());
+    for (Retired& x : to_delete) {  // deleter 可能再次调用 retire
+      x.deleter(x.p);
+    }
+  }
+
+ private:
+  std::atomic<Record*> records_ = nullptr;
+  std::atomic<std::size_t> record_cnt_ = 0;
+  std::mutex orphans_m_;
+  std::vector<Retired> orphans_;  // 已退出线程留下的待删除节点
+  std::atomic<bool> has_orphans_ = false;
+};
+
+// 持有一个风险指针，析构时清空并归还
+class HazardPointerGuard {
+ public:
+  HazardPointerGuard() : r_(HazardPointerDomain::instance().acquire()) {}
+
+  ~HazardPointerGuard() { HazardPointerDomain::instance().release(r_); }
+
+  HazardPointerGuard(const HazardPointerGuard&) = delete;
+
+  HazardPointerGuard& operator=(const HazardPointerGuard&) = delete;
+
+  // 循环至风险指针保存的就是 src 当前的值，返回后该对象不会被释放
+  template <typename U>
+  U* protect(const std::atomic<U*>& src) {
+    U* p = src.load(std::memory_order_relaxed);
+    while (true) {
+      r_->p.store(p, std::memory_order_relaxed);
+      asymmetric_light_fence();  // 与扫描一侧的 heavy fence 配对
+      U* cur = src.load(std::memory_order_acquire);
+      if (cur == p) {
+        return p;
+      }
+      p = cur;
+    }
+  }
+
+  void reset() { r_->p.store(nullptr, std::memory_order_release); }
+
+ private:
+  HazardPointerDomain::Record* r_;
+};
+
+// 风险指针回收器，接口见 reclaimer.hpp。
+// 每个 Guard 只能保护一个指针，需要同时保护多个对象时使用多个 Guard
+struct HazardPointerReclaimer {
+  using Guard = HazardPointerGuard;
+
+  static constexpr bool ProtectsScope = false;
+
+  static void retire(void* p, void (*deleter)(void*)) {
+    HazardPointerDomain::instance().retire(p, deleter);
+  }
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// 层级检查默认只在调试构建中开启。发布构建中可以定义
+// HIERARCHICAL_MUTEX_CHECK 为 1 开启（如预发布环境），为 0 时
+// HierarchicalMutex 与 Mutex 大小相同，每个操作只是转发，没有额外开销。
+// 所有翻译单元必须使用相同的设置
+#if !defined(HIERARCHICAL_MUTEX_CHECK)
+#if defined(NDEBUG)
+#define HIERARCHICAL_MUTEX_CHECK 0
+#else
+#define HIERARCHICAL_MUTEX_CHECK 1
+#endif
+#endif
+
+#if HIERARCHICAL_MUTEX_CHECK
+// 当前线程持有的层级锁，层级值从栈底到栈顶严格递减。
+// 解锁可以不按加锁的逆序，因此记录每个锁自身，而不是只记录最近的层级值
+class HierarchyStack {
+ public:
+  static constexpr std::size_t MaxDepth = 32;
+
+  // 只能获取层级值低于当前所有已持有锁的锁
+  static void check(const void* m, unsigned long level) {
+    const HierarchyStack& s = local();
+    if (s.size_ == MaxDepth) {
+      throw std::logic_error("mutex hierarchy too deep");
+    }
+    if (s.size_ > 0 && s.held_[s.size_ - 1].level <= level) {
+      throw std::logic_error(
+          "mutex hierarchy violated: locking " + std::to_string(level) +
+          " while holding " + std::to_string(s.held_[s.size_ - 1].level));
+    }
+    for (std::size_t i = 0; i < s.size_; ++i) {
+      if (s.held_[i].m == m) {
+        throw std::logic_error("mutex already held by this thread");
+      }
+    }
+  }
+
+  static void push(const void* m, unsigned long level) {
+    HierarchyStack& s = local();
+    s.held_[s.size_++] = Held{m, level};
+  }
+
+  static void pop(const void* m) {
+    HierarchyStack& s = local();
+    for (std::size_t i = s.size_; i-- > 0;) {  // 通常就是栈顶
+      if (s.held_[i].m == m) {
+        for (; i + 1 < s.size_; ++i) {
+          s.held_[i] = s.held_[i + 1];
+        }
+        --s.size_;
+        return;
+      }
+    }
+    throw std::logic_error("unlocking a mutex not held by this thread");
+  }
+
+ private:
+  struct Held {
+    const void* m;
+    unsigned long level;
+  };
+
+  static HierarchyStack& local() {
+    static thread_local HierarchyStack res;
+    return res;
+  }
+
+ private:
+  Held held_[MaxDepth];
+  std::size_t size_ = 0;
+};
+#endif
+
+// 带层级的锁，防止因加锁顺序不一致产生的死锁：
+// 线程持有锁时只能再获取层级值更低的锁，违反时 lock 抛出 std::logic_error。
+// Mutex 可以是任何满足 Lockable 的锁，如 std::mutex、std::shared_mutex，
+// Mutex 支持共享锁时也提供 lock_shared 等，可以用于 std::shared_lock。
+// 共享锁与独占锁遵循同样的规则，同一层级的两个读锁也会与写者死锁
+template <typename Mutex = std::mutex>
+class HierarchicalMutex {
+ public:
+  explicit HierarchicalMutex([[maybe_unused]] unsigned long level)
+#if HIERARCHICAL_MUTEX_CHECK
+      : level_(level)
+#endif
+  {
+  }
+
+  HierarchicalMutex(const HierarchicalMutex&) = delete;
+
+  HierarchicalMutex& operator=(const HierarchicalMutex&) = delete;
+
+  void lock() {
+    check();
+    m_.lock();
+    push();
+  }
+
+  bool try_lock() {
+    check();
+    if (!m_.try_lock()) {
+      return false;
+    }
+    push();
+    return true;
+  }
+
+  void unlock() {
+    pop();
+    m_.unlock();
+  }
+
+  template <typename M = Mutex>
+  auto lock_shared() -> decltype(std::declval<M&>().lock_shared()) {
+    check();
+    m_.lock_shared();
+    push();
+  }
+
+  template <typename M = Mutex>
+  auto try_lock_shared() -> decltype(std::declval<M&>().try_lock_shared()) {
+    check();
+    if (!m_.try_lock_shared()) {
+      return false;
+    }
+    push();
+    return true;
+  }
+
+  template <typename M = Mutex>
+  auto unlock_shared() -> decltype(std::declval<M&>().unlock_shared()) {
+    pop();
+    m_.unlock_shared();
+  }
+
+ private:
+#if HIERARCHICAL_MUTEX_CHECK
+  void check() const { HierarchyStack::check(this, level_); }
+
+  void push() const { HierarchyStack::push(this, level_); }
+
+  void pop() const { HierarchyStack::pop(this); }
+#else
+  void check() const {}
+
+  void push() const {}
+
+  void pop() const {}
+#endif
+
+ private:
+  Mutex m_;
+#if HIERARCHICAL_MUTEX_CHECK
+  const unsigned long level_;
+#endif
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "cpu_relax.hpp"
+#include "reclaimer.hpp"
+
+// 惰性同步的链表，接口与 ConcurrentList 相同。
+// 遍历不加锁，删除分两步：先在节点上做逻辑删除标记，再从链表中摘除，
+// 只需锁住前驱和待删除的两个节点，加锁后验证两者都未被标记且仍然相邻。
+// 已标记的节点对遍历不可见，摘除后交给 Reclaimer，因此遍历中读到的节点
+// 不会被释放。元素插入后不再修改，f 得到的是 const T&。
+// 节点只含 next 指针、两个标志和元素本身，元素直接存放在节点中
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Reclaimer = EpochReclaimer>
+class LazyConcurrentList {
+  static_assert(Reclaimer::ProtectsScope,
+                "traversal needs a reclaimer that protects a whole scope");
+
+ public:
+  LazyConcurrentList() = default;
+
+  ~LazyConcurrentList() {
+    Link* p = head_.next.load(std::memory_order_relaxed);
+    while (p) {
+      Link* next = p->next.load(std::memory_order_relaxed);
+      destroy_node(static_cast<Node*>(p));
+      p = next;
+    }
+  }
+
+  LazyConcurrentList(const LazyConcurrentList&) = delete;
+
+  LazyConcurrentList& operator=(const LazyConcurrentList&) = delete;
+
+  // 头节点不会被删除，加锁后无需验证
+  void push_front(const T& x) {
+    Node* t = make_node(x);
+    head_.lock();
+    t->next.store(head_.next.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+    head_.next.store(t, std::memory_order_release);
+    head_.unlock();
+  }
+
+  template <typename F>
+  void for_each(F f) const {
+    typename Reclaimer::Guard guard;
+    for (const Link* p = first(); p; p = next_of(p)) {
+      if (!p->marked.load(std::memory_order_acquire)) {
+        f(value(p));
+      }
+    }
+  }
+
+  // 返回第一个满足 f 的元素的副本
+  template <typename F>
+  std::optional<T> find_first_if(F f) const {
+    typename Reclaimer::Guard guard;
+    for (const Link* p = first(); p; p = next_of(p)) {
+      if (!p->marked.load(std::memory_order_acquire) && f(value(p))) {
+        return value(p);
+      }
+    }
+    return std::nullopt;
+  }
+
+  // 验证失败时会重新检查，f 可能对同一元素调用多次
+  template <typename F>
+  void remove_if(F f) {
+    typename Reclaimer::Guard guard;
+    Link* pred = &head_;
+    Link* cur = first();
+    while (cur) {
+      if (cur->marked.load(std::memory_order_acquire) || !f(value(cur))) {
+        pred = cur;
+        cur = next_of(cur);
+        continue;
+      }
+      pred->lock();
+      cur->lock();
+      const bool valid = !pred->marked.load(std::memory_order_relaxed) &&
+                         !cur->marked.load(std::memory_order_relaxed) &&
+                         pred->next.load(std::memory_order_relaxed) == cur;
+      Link* next = cur->next.load(std::memory_order_relaxed);
+      if (valid) {
+        cur->marked.store(true, std::memory_order_release);
+        pred->next.store(next, std::memory_order_release);
+      }
+      cur->unlock();
+      pred->unlock();
+      if (valid) {
+        Reclaimer::retire(static_cast<Node*>(cur), &destroy_node);
+        cur = next;
+        continue;
+      }
+      // pred 已被删除时从头开始，否则 pred 之后插入了新节点或 cur 已被删除
+      if (pred->marked.load(std::memory_order_acquire)) {
+        pred = &head_;
+      }
+      cur = next_of(pred);
+    }
+  }
+
+ private:
+  struct Link {
+    std::atomic<Link*> next = nullptr;
+    std::atomic<bool> locked = false;
+    std::atomic<bool> marked = false;  // 已逻辑删除
+
+    void lock() {
+      std::size_t spins = 0;
+      while (locked.exchange(true, std::memory_order_acquire)) {
+        while (locked.load(std::memory_order_relaxed)) {
+          if (++spins < SpinCount) {
+            cpu_relax();
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      }
+    }
+
+    void unlock() { locked.store(false, std::memory_order_release); }
+  };
+
+  struct Node : Link {
+    T v;
+    Node(const T& x) : v(x) {}
+  };
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  static constexpr std::size_t SpinCount = 64;
+
+  static Node* make_node(const T& x) {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    try {
+      NodeTraits::construct(a, p, x);
+    } catch (...) {
+      NodeTraits::deallocate(a, p, 1);
+      throw;
+    }
+    return p;
+  }
+
+  static void destroy_node(void* p) {
+    NodeAllocator a;
+    Node* t = static_cast<Node*>(p);
+    NodeTraits::destroy(a, t);
+    NodeTraits::deallocate(a, t, 1);
+  }
+
+  static const T& value(const Link* p) {
+    return static_cast<const Node*>(p)->v;
+  }
+
+  Link* first() const { return next_of(&head_); }
+
+  static Link* next_of(const Link* p) {
+    return p->next.load(std::memory_order_acquire);
+  }
+
+ private:
+  Link head_;  // 哨兵节点，不含元素
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "cpu_relax.hpp"
+
+// 基于数组的有界 MPMC 队列（Dmitry Vyukov 的算法），
+// 每个槽位有一个序号，生产者和消费者通过 CAS 推进 tail_ 和 head_ 认领槽位，
+// 再根据槽位序号判断它是否可写或可读。
+// 构造时一次性分配所有槽位，之后 push 和 pop(T&) 都不再分配内存
+template <typename T>
+class LockFreeBoundedQueue {
+  // 认领槽位后无法回滚，因此要求移动操作不抛异常
+  static_assert(std::is_nothrow_move_constructible_v<T> &&
+                    std::is_nothrow_move_assignable_v<T>,
+                "T must be nothrow movable");
+
+ public:
+  // 容量向上取整为 2 的幂，以便用位与代替取模
+  explicit LockFreeBoundedQueue(std::size_t capacity) {
+    std::size_t n = 2;
+    while (n < capacity) {
+      n <<= 1;
+    }
+    mask_ = n - 1;
+    cells_.reset(new Cell[n]);
+    for (std::size_t i = 0; i < n; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~LockFreeBoundedQueue() {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t i = head_.load(std::memory_order_relaxed);
+    for (; i != tail; ++i) {
+      std::launder(reinterpret_cast<T*>(cells_[i & mask_].storage))->~T();
+    }
+  }
+
+  LockFreeBoundedQueue(const LockFreeBoundedQueue&) = delete;
+
+  LockFreeBoundedQueue& operator=(const LockFreeBoundedQueue&) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // 队列满时返回 false，此时 x 不会被移走
+  bool try_push(T&& x) { return try_push_moved(x); }
+
+  bool try_push(const T& x) {
+    T t(x);
+    return try_push_moved(t);
+  }
+
+  // 队列满时阻塞
+  void push(T x) {
+    for (std::size_t i = 0; i < SpinCount; ++i) {
+      if (try_push_moved(x)) {
+        return;
+      }
+      cpu_relax();
+    }
+    {
+      std::unique_lock<std::mutex> l(m_);
+      push_waiters_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // 持有 m_，不能调用 notify
+      not_full_.wait(l, [&] { return enqueue(x); });
+      push_waiters_.fetch_sub(1);
+    }
+    notify(pop_waiters_, not_empty_);
+  }
+
+  bool try_pop(T& res) {
+    return dequeue_and_notify([&](T&& x) { res = std::move(x); });
+  }
+
+  // 与 ConcurrentQueue 接口一致，但需要为结果分配内存
+  std::shared_ptr<T> try_pop() {
+    std::shared_ptr<T> res;
+    dequeue_and_notify(
+        [&](T&& x) { res = std::make_shared<T>(std::move(x)); });
+    return res;
+  }
+
+  void wait_and_pop(T& res) {
+    wait_and_dequeue([&](T&& x) { res = std::move(x); });
+  }
+
+  std::shared_ptr<T> wait_and_pop() {
+    std::shared_ptr<T> res;
+    wait_and_dequeue([&](T&& x) { res = std::make_shared<T>(std::move(x)); });
+    return res;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr std::size_t CacheLineSize = 64;
+  static constexpr std::size_t SpinCount = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  // 成功时才移走 x，失败时 x 保持不变
+  bool enqueue(T& x) {
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {  // 槽位空闲，尝试认领
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {  // 槽位中的元素还未被取走，队列已满
+        return false;
+      } else {  // 其他生产者已认领该槽位
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void*>(cell->storage)) T(std::move(x));
+    cell->seq.store(pos + 1, std::memory_order_release);  // 标记为可读
+    return true;
+  }
+
+  // 认领一个可读槽位，把其中的元素交给 f
+  template <typename F>
+  bool dequeue(F&& f) {
+    std::size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+                                  static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {  // 槽位可读，尝试认领
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {  // 生产者还未写入，队列为空
+        return false;
+      } else {  // 其他消费者已认领该槽位
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    // f 抛异常（如 make_shared 分配失败）时元素被丢弃，但仍要析构元素并
+    // 推进序号，否则下一轮的生产者会一直等待这个槽位
+    struct Release {
+      ~Release() {
+        p->~T();
+        // 序号加上容量，标记为下一轮生产者可写
+        cell->seq.store(seq, std::memory_order_release);
+      }
+
+      Cell* cell;
+      T* p;
+      std::size_t seq;
+    } release{cell, std::launder(reinterpret_cast<T*>(cell->storage)),
+              pos + mask_ + 1};
+    f(std::move(*release.p));
+    return true;
+  }
+
+  bool try_push_moved(T& x) {
+    if (!enqueue(x)) {
+      return false;
+    }
+    notify(pop_waiters_, not_empty_);
+    return true;
+  }
+
+  template <typename F>
+  bool dequeue_and_notify(F&& f) {
+    if (!dequeue(f)) {
+      return false;
+    }
+    notify(push_waiters_, not_full_);
+    return true;
+  }
+
+  template <typename F>
+  void wait_and_dequeue(F&& f) {
+    for (std::size_t i = 0; i < SpinCount; ++i) {
+      if (dequeue_and_notify(f)) {
+        return;
+      }
+      cpu_relax();
+    }
+    {
+      std::unique_lock<std::mutex> l(m_);
+      pop_waiters_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // 持有 m_，不能调用 notify
+      not_empty_.wait(l, [&] { return dequeue(f); });
+      pop_waiters_.fetch_sub(1);
+    }
+    notify(push_waiters_, not_full_);
+  }
+
+  // 只有存在等待者时才加锁唤醒，fence 与等待者一侧的 fence 配对，
+  // 保证要么这里看到等待者，要么等待者看到新状态
+  void notify(std::atomic<std::size_t>& waiters, std::condition_variable& cv) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+      { std::lock_guard<std::mutex> l(m_); }
+      cv.notify_one();
+    }
+  }
+
+ private:
+  // head_ 和 tail_ 分别被消费者和生产者频繁修改，放在不同缓存行
+  alignas(CacheLineSize) std::atomic<std::size_t> head_ = 0;
+  alignas(CacheLineSize) std::atomic<std::size_t> tail_ = 0;
+  alignas(CacheLineSize) std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+  std::atomic<std::size_t> pop_waiters_ = 0;
+  std::atomic<std::size_t> push_waiters_ = 0;
+  std::mutex m_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "reclaimer.hpp"
+
+// Harris 风格的无锁链表，接口与 LazyConcurrentList 相同。
+// next 指针的最低位作为删除标记：删除时先用 CAS 标记节点自己的 next，
+// 之后该节点的 next 不会再被修改，再用 CAS 把前驱的 next 指向后继。
+// 第二步失败时保留标记，之后经过的 remove_if 会帮助摘除。
+// 成功摘除节点的线程把它交给 Reclaimer，遍历中读到的节点不会被释放。
+// 元素插入后不再修改，f 得到的是 const T&。节点只含 next 和元素
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Reclaimer = EpochReclaimer>
+class LockFreeList {
+  static_assert(Reclaimer::ProtectsScope,
+                "traversal needs a reclaimer that protects a whole scope");
+
+ public:
+  LockFreeList() = default;
+
+  ~LockFreeList() {
+    Node* p = pointer(head_.load(std::memory_order_relaxed));
+    while (p) {
+      Node* next = pointer(p->next.load(std::memory_order_relaxed));
+      destroy_node(p);
+      p = next;
+    }
+  }
+
+  LockFreeList(const LockFreeList&) = delete;
+
+  LockFreeList& operator=(const LockFreeList&) = delete;
+
+  void push_front(const T& x) {
+    Node* t = make_node(x);
+    // 头指针不会被标记
+    Word h = head_.load(std::memory_order_relaxed);
+    do {
+      t->next.store(h, std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(h, word(t), std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  template <typename F>
+  void for_each(F f) const {
+    typename Reclaimer::Guard guard;
+    Node* p = pointer(head_.load(std::memory_order_acquire));
+    while (p) {
+      const Word next = p->next.load(std::memory_order_acquire);
+      if (!marked(next)) {
+        f(std::as_const(p->v));
+      }
+      p = pointer(next);
+    }
+  }
+
+  // 返回第一个满足 f 的元素的副本
+  template <typename F>
+  std::optional<T> find_first_if(F f) const {
+    typename Reclaimer::Guard guard;
+    Node* p = pointer(head_.load(std::memory_order_acquire));
+    while (p) {
+      const Word next = p->next.load(std::memory_order_acquire);
+      if (!marked(next) && f(std::as_const(p->v))) {
+        return p->v;
+      }
+      p = pointer(next);
+    }
+    return std::nullopt;
+  }
+
+  // 前驱被其他线程删除时从头开始，f 可能对同一元素调用多次
+  template <typename F>
+  void remove_if(F f) {
+    typename Reclaimer::Guard guard;
+    std::atomic<Word>* prev = &head_;
+    Word cur = prev->load(std::memory_order_acquire);
+    while (Node* p = pointer(cur)) {
+      if (marked(cur)) {  // prev 所在的节点已被删除
+        prev = &head_;
+        cur = prev->load(std::memory_order_acquire);
+        continue;
+      }
+      Word next = p->next.load(std::memory_order_acquire);
+      if (marked(next)) {  // p 已被逻辑删除，帮助摘除
+        unlink(*prev, cur, p, next & ~Mark);
+        continue;
+      }
+      if (!f(std::as_const(p->v))) {
+        prev = &p->next;
+        cur = next;
+        continue;
+      }
+      // 失败说明 p 被其他线程标记或后继发生了变化，重新检查 p
+      if (p->next.compare_exchange_strong(next, next | Mark,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+        unlink(*prev, cur, p, next);
+      }
+    }
+  }
+
+ private:
+  using Word = std::uintptr_t;
+
+  static constexpr Word Mark = 1;
+
+  struct Node {
+    std::atomic<Word> next = 0;
+    T v;
+    Node(const T& x) : v(x) {}
+  };
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  static Node* make_node(const T& x) {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    try {
+      NodeTraits::construct(a, p, x);
+    } catch (...) {
+      NodeTraits::deallocate(a, p, 1);
+      throw;
+    }
+    return p;
+  }
+
+  static void destroy_node(void* p) {
+    NodeAllocator a;
+    NodeTraits::destroy(a, static_cast<Node*>(p));
+    NodeTraits::deallocate(a, static_cast<Node*>(p), 1);
+  }
+
+  static Word word(Node* p) { return reinterpret_cast<Word>(p); }
+
+  static Node* pointer(Word w) { return reinterpret_cast<Node*>(w & ~Mark); }
+
+  static bool marked(Word w) { return w & Mark; }
+
+  // 把已标记的 p 从 prev 摘除，成功时回收 p，返回后 cur 为 prev 的当前值
+  static void unlink(std::atomic<Word>& prev, Word& cur, Node* p, Word next) {
+    if (prev.compare_exchange_strong(cur, next, std::memory_order_acq_rel,
+                                     std::memory_order_acquire)) {
+      Reclaimer::retire(p, &destroy_node);
+      cur = next;
+    }
+  }
+
+ private:
+  std::atomic<Word> head_ = 0;
+};
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "cpu_relax.hpp"
+#include "reclaimer.hpp"
+
+// 无界 MPMC 无锁队列（Michael-Scott 算法），接口与 ConcurrentQueue 一致。
+// head_ 始终指向一个哑节点，第一个元素在 head_->next 中。
+// 生产者用 CAS 把新节点接到尾节点的 next 上，再用 CAS 推进 tail_，
+// 第二步可能落后，任何线程看到 tail_->next 非空时都会先帮助推进 tail_，
+// 因此没有线程需要等待其他线程完成操作。
+// 消费者用 CAS 推进 head_，旧的哑节点交给 Reclaimer，见 reclaimer.hpp。
+// Allocator 用于分配节点，需要无状态且可默认构造，如 PoolAllocator<T>
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Reclaimer = HazardPointerReclaimer>
+class LockFreeQueue {
+ public:
+  LockFreeQueue() {
+    Node* dummy = make_node();
+    head_.store(dummy, std::memory_order_relaxed);
+    tail_.store(dummy, std::memory_order_relaxed);
+  }
+
+  ~LockFreeQueue() {
+    Node* dummy = head_.load(std::memory_order_relaxed);
+    Node* p = dummy->next.load(std::memory_order_relaxed);
+    destroy_node(dummy);  // 哑节点不含元素
+    while (p) {
+      Node* next = p->next.load(std::memory_order_relaxed);
+      p->value()->~T();
+      destroy_node(p);
+      p = next;
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+  void push(T x) {
+    Node* p = make_node(std::move(x));
+    link(p, p);
+    notify(false);
+  }
+
+  // 在队列外把所有元素串成一条链表，一次 CAS 接到尾部，并只通知一次
+  template <typename InputIt>
+  void push_bulk(InputIt first, InputIt last) {
+    if (first == last) {
+      return;
+    }
+    Node* const first_node = make_node(*first);
+    Node* last_node = first_node;
+    try {
+      for (++first; first != last; ++first) {
+        Node* p = make_node(*first);
+        last_node->next.store(p, std::memory_order_relaxed);
+        last_node = p;
+      }
+    } catch (...) {
+      for (Node* p = first_node; p;) {
+        Node* next = p->next.load(std::memory_order_relaxed);
+        p->value()->~T();
+        destroy_node(p);
+        p = next;
+      }
+      throw;
+    }
+    link(first_node, last_node);
+    notify(true);
+  }
+
+  std::shared_ptr<T> try_pop() {
+    std::shared_ptr<T> res;
+    dequeue([&](T&& x) {
+      res = std::allocate_shared<T>(Allocator{}, std::move(x));
+    });
+    return res;
+  }
+
+  bool try_pop(T& res) {
+    return dequeue([&](T&& x) { res = std::move(x); });
+  }
+
+  std::shared_ptr<T> wait_and_pop() {
+    std::shared_ptr<T> res;
+    wait_and_dequeue([&](T&& x) {
+      res = std::allocate_shared<T>(Allocator{}, std::move(x));
+    });
+    return res;
+  }
+
+  void wait_and_pop(T& res) {
+    wait_and_dequeue([&](T&& x) { res = std::move(x); });
+  }
+
+  // 超时返回 nullptr
+  template <typename Rep, typename Period>
+  std::shared_ptr<T> wait_and_pop_for(
+      const std::chrono::duration<Rep, Period>& timeout) {
+    std::shared_ptr<T> res;
+    wait_and_dequeue_until(
+        std::chrono::steady_clock::now() + timeout, [&](T&& x) {
+          res = std::allocate_shared<T>(Allocator{}, std::move(x));
+        });
+    return res;
+  }
+
+  template <typename Rep, typename Period>
+  bool wait_and_pop_for(T& res,
+                        const std::chrono::duration<Rep, Period>& timeout) {
+    return wait_and_dequeue_until(std::chrono::steady_clock::now() + timeout,
+                                  [&](T&& x) { res = std::move(x); });
+  }
+
+  // 取出至多 max 个元素写入 out，返回取出的个数
+  template <typename OutputIt>
+  std::size_t try_pop_bulk(OutputIt out, std::size_t max) {
+    std::size_t n = 0;
+    while (n < max && dequeue([&](T&& x) {
+             *out = std::move(x);
+             ++out;
+           })) {
+      ++n;
+    }
+    return n;
+  }
+
+  bool empty() const {
+    typename Reclaimer::Guard guard;
+    Node* head = guard.protect(head_);
+    return head->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  static constexpr std::size_t CacheLineSize = 64;
+  static constexpr std::size_t SpinCount = 64;
+
+  struct Node {
+    std::atomic<Node*> next = nullptr;
+    alignas(T) unsigned char storage[sizeof(T)];  // 哑节点中没有元素
+
+    T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  static Node* make_node() {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    NodeTraits::construct(a, p);  // Node 的构造不会抛出异常
+    return p;
+  }
+
+  template <typename U>
+  static Node* make_node(U&& x) {
+    Node* p = make_node();
+    try {
+      ::new (static_cast<void*>(p->storage)) T(std::forward<U>(x));
+    } catch (...) {
+      destroy_node(p);
+      throw;
+    }
+    return p;
+  }
+
+  // 只释放节点，元素已被取走或由调用者析构
+  static void destroy_node(void* p) {
+    NodeAllocator a;
+    NodeTraits::destroy(a, static_cast<Node*>(p));
+    NodeTraits::deallocate(a, static_cast<Node*>(p), 1);
+  }
+
+  // 把 first 到 last 的一串节点接到队尾
+  void link(Node* first, Node* last) {
+    typename Reclaimer::Guard guard;
+    while (true) {
+      Node* tail = guard.protect(tail_);
+      Node* next = tail->next.load(std::memory_order_acquire);
+      if (next) {  // tail_ 落后，先帮助推进
+        tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                    std::memory_order_relaxed);
+        continue;
+      }
+      if (tail->next.compare_exchange_weak(next, first,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        // 失败说明其他线程已帮助推进，末尾的节点留给之后的线程
+        tail_.compare_exchange_strong(tail, last, std::memory_order_release,
+                                      std::memory_order_relaxed);
+        return;
+      }
+      cpu_relax();
+    }
+  }
+
+  // 摘下第一个元素交给 f
+  template <typename F>
+  bool dequeue(F&& f) {
+    typename Reclaimer::Guard head_guard;
+    typename Reclaimer::Guard next_guard;
+    while (true) {
+      Node* head = head_guard.protect(head_);
+      Node* next = next_guard.protect(head->next);
+      // next 可能在 protect 生效前随 head 一起被摘下并释放，
+      // head_ 未变说明 head 仍是哑节点，next 也就还未被释放
+      if (head_.load(std::memory_order_acquire) != head) {
+        continue;
+      }
+      if (!next) {
+        return false;
+      }
+      Node* tail = tail_.load(std::memory_order_acquire);
+      if (head == tail) {  // tail_ 落后，先帮助推进，保证 head_ 不越过 tail_
+        tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                    std::memory_order_relaxed);
+        continue;
+      }
+      // release 使之后读取 head_ 的线程也能看到 next 的内容
+      if (head_.compare_exchange_weak(head, next, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+        // next 成为新的哑节点，其中的元素只归成功推进 head_ 的线程所有。
+        // 元素已经出队，f 抛出异常时元素丢失，但节点仍会被回收
+        T* p = next->value();
+        struct Cleanup {
+          T* p;
+          Node* head;
+          ~Cleanup() {
+            p->~T();
+            Reclaimer::retire(head, &destroy_node);
+          }
+        } cleanup{p, head};
+        f(std::move(*p));
+        return true;
+      }
+    }
+  }
+
+  template <typename F>
+  void wait_and_dequeue(F&& f) {
+    for (std::size_t i = 0; i < SpinCount; ++i) {
+      if (dequeue(f)) {
+        return;
+      }
+      cpu_relax();
+    }
+    std::unique_lock<std::mutex> l(m_);
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv_.wait(l, [&] { return dequeue(f); });
+    waiters_.fetch_sub(1);
+  }
+
+  template <typename F>
+  bool wait_and_dequeue_until(std::chrono::steady_clock::time_point deadline,
+                              F&& f) {
+    std::unique_lock<std::mutex> l(m_);
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool res = cv_.wait_until(l, deadline, [&] { return dequeue(f); });
+    waiters_.fetch_sub(1);
+    return res;
+  }
+
+  // 只有存在等待者时才加锁唤醒，fence 与等待者一侧的 fence 配对，
+  // 保证要么这里看到等待者，要么等待者看到新元素
+  void notify(bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      { std::lock_guard<std::mutex> l(m_); }
+      if (all) {
+        cv_.notify_all();
+      } else {
+        cv_.notify_one();
+      }
+    }
+  }
+
+ private:
+  // head_ 和 tail_ 分别被消费者和生产者频繁修改，放在不同缓存行
+  alignas(CacheLineSize) std::atomic<Node*> head_;
+  alignas(CacheLineSize) std::atomic<Node*> tail_;
+  alignas(CacheLineSize) std::atomic<std::size_t> waiters_ = 0;
+  std::mutex m_;
+  std::condition_variable cv_;
+};
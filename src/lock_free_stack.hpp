@@ -3,7 +3,8 @@
 #include <atomic>
 #include <memory>
 
-template <typename T>
+// Allocator 用于分配节点和元素，需要无状态且可默认构造，如 PoolAllocator<T>
+template <typename T, typename Allocator = std::allocator<T>>
 class LockFreeStack {
  public:
   ~LockFreeStack() {
@@ -13,7 +14,7 @@ class LockFreeStack {
 
   void push(const T& x) {
     ReferenceCount t;
-    t.p = new Node(x);
+    t.p = make_node(x);
     t.external_cnt = 1;
     // 下面比较中 release 保证之前的语句都先执行，因此 load 可以使用 relaxed
     t.p->next = head_.load(std::memory_order_relaxed);
@@ -39,14 +40,14 @@ class LockFreeStack {
         const int cnt = t.external_cnt - 2;
         // swap 要先于 delete，因此使用 release
         if (p->inner_cnt.fetch_add(cnt, std::memory_order_release) == -cnt) {
-          delete p;  // 内外部计数和为 0
+          destroy_node(p);  // 内外部计数和为 0
         }
         return res;
       }
       if (p->inner_cnt.fetch_sub(1, std::memory_order_relaxed) == 1) {
         p->inner_cnt.load(std::memory_order_acquire);  // 只是用 acquire 来同步
         // acquire 保证 delete 在之后执行
-        delete p;  // 内部计数为 0
+        destroy_node(p);  // 内部计数为 0
       }
     }
   }
@@ -63,9 +64,31 @@ class LockFreeStack {
     std::shared_ptr<T> v;
     std::atomic<int> inner_cnt = 0;
     ReferenceCount next;
-    Node(const T& x) : v(std::make_shared<T>(x)) {}
+    Node(const T& x) : v(std::allocate_shared<T>(Allocator{}, x)) {}
   };
 
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+  static Node* make_node(const T& x) {
+    NodeAllocator a;
+    Node* p = NodeTraits::allocate(a, 1);
+    try {
+      NodeTraits::construct(a, p, x);
+    } catch (...) {
+      NodeTraits::deallocate(a, p, 1);
+      throw;
+    }
+    return p;
+  }
+
+  static void destroy_node(Node* p) noexcept {
+    NodeAllocator a;
+    NodeTraits::destroy(a, p);
+    NodeTraits::deallocate(a, p, 1);
+  }
+
   void increase_count(ReferenceCount& old_cnt) {
     ReferenceCount new_cnt;
     do {  // 比较失败不改变当前值，并可以继续循环，因此可以选择 relaxed
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "cpu_relax.hpp"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define LOCK_POLICY_FUTEX 1
+#endif
+
+// 容器用模板参数 Mutex 选择锁的实现，默认为 std::mutex，也可以是
+// 以下任何一种锁。临界区只有几次指针操作时自旋锁避免了陷入内核，
+// 竞争激烈时 McsLock 让每个等待者只在自己的节点上自旋，并按到达顺序获得锁。
+// 每种锁都接受一个计数策略 Counters，默认不统计，没有任何开销
+
+struct LockStats {
+  std::uint64_t acquisitions = 0;
+  std::uint64_t contended = 0;  // 第一次尝试失败、需要等待的次数
+  std::chrono::nanoseconds wait_time{};  // 所有等待的总时间
+};
+
+struct NoLockCounters {
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static void acquired() {}
+
+  static TimePoint wait_begin() { return TimePoint(); }
+
+  static void wait_end(TimePoint) {}
+};
+
+// 使用同一 Tag 的所有锁共享一组计数器，如一个容器的所有桶锁，
+// 按容器区分 Tag 即可分别调整每个容器的锁：
+//   using QueueLock = TtasSpinLock<LockCounters<struct QueueLockTag>>;
+//   LockCounters<QueueLockTag>::stats();
+template <typename Tag>
+class LockCounters {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static void acquired() {
+    data().acquisitions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // 只在需要等待时读取时钟
+  static TimePoint wait_begin() { return std::chrono::steady_clock::now(); }
+
+  static void wait_end(TimePoint start) {
+    const auto wait = std::chrono::steady_clock::now() - start;
+    Data& d = data();
+    d.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    d.contended.fetch_add(1, std::memory_order_relaxed);
+    d.wait_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count(),
+        std::memory_order_relaxed);
+  }
+
+  static LockStats stats() {
+    const Data& d = data();
+    LockStats res;
+    res.acquisitions = d.acquisitions.load(std::memory_order_relaxed);
+    res.contended = d.contended.load(std::memory_order_relaxed);
+    res.wait_time = std::chrono::nanoseconds(
+        d.wait_ns.load(std::memory_order_relaxed));
+    return res;
+  }
+
+  static void reset() {
+    Data& d = data();
+    d.acquisitions.store(0, std::memory_order_relaxed);
+    d.contended.store(0, std::memory_order_relaxed);
+    d.wait_ns.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  struct alignas(64) Data {
+    std::atomic<std::uint64_t> acquisitions = 0;
+    std::atomic<std::uint64_t> contended = 0;
+    std::atomic<std::int64_t> wait_ns = 0;
+  };
+
+  static Data& data() {
+    static Data res;
+    return res;
+  }
+};
+
+// TTAS 自旋锁：先只读等待锁释放再尝试 exchange，等待期间不反复使缓存行失效。
+// 每次失败后退避时间加倍，到达上限后 yield，线程数多于核数时不会空转
+template <typename Counters = NoLockCounters>
+class TtasSpinLock {
+ public:
+  TtasSpinLock() = default;
+
+  TtasSpinLock(const TtasSpinLock&) = delete;
+
+  TtasSpinLock& operator=(const TtasSpinLock&) = delete;
+
+  void lock() {
+    if (!locked_.exchange(true, std::memory_order_acquire)) {
+      Counters::acquired();
+      return;
+    }
+    const auto start = Counters::wait_begin();
+    std::size_t backoff = 1;
+    do {
+      while (locked_.load(std::memory_order_relaxed)) {
+        if (backoff < MaxBackoff) {
+          for (std::size_t i = 0; i < backoff; ++i) {
+            cpu_relax();
+          }
+          backoff <<= 1;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    } while (locked_.exchange(true, std::memory_order_acquire));
+    Counters::wait_end(start);
+  }
+
+  bool try_lock() {
+    if (locked_.load(std::memory_order_relaxed) ||
+        locked_.exchange(true, std::memory_order_acquire)) {
+      return false;
+    }
+    Counters::acquired();
+    return true;
+  }
+
+  void unlock() { locked_.store(false, std::memory_order_release); }
+
+ private:
+  static constexpr std::size_t MaxBackoff = 1024;
+
+ private:
+  std::atomic<bool> locked_ = false;
+};
+
+// 先自旋，仍未获得锁再用 futex 休眠。自旋次数按最近几次实际等待的次数调整，
+// 持有时间短的锁多自旋，自旋总是失败的锁很快改为直接休眠。
+// state_：0 未加锁，1 已加锁且无人休眠，2 已加锁且可能有线程休眠，
+// 无竞争时加锁和解锁各一次原子操作，不进入内核
+template <typename Counters = NoLockCounters>
+class AdaptiveMutex {
+ public:
+  AdaptiveMutex() = default;
+
+  AdaptiveMutex(const AdaptiveMutex&) = delete;
+
+  AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+  void lock() {
+    std::uint32_t c = 0;
+    if (state_.compare_exchange_strong(c, 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      Counters::acquired();
+      return;
+    }
+    const auto start = Counters::wait_begin();
+    const std::uint32_t limit = std::min<std::uint32_t>(
+        MaxSpin, spins_.load(std::memory_order_relaxed) * 2 + 16);
+    for (std::uint32_t i = 0; i < limit; ++i) {
+      c = 0;
+      if (state_.load(std::memory_order_relaxed) == 0 &&
+          state_.compare_exchange_weak(c, 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        adapt(i);
+        Counters::wait_end(start);
+        return;
+      }
+      cpu_relax();
+    }
+    adapt(limit);
+    // 标记为有人休眠后再等待，解锁者看到 2 才会唤醒
+    c = state_.exchange(2, std::memory_order_acquire);
+    while (c != 0) {
+      wait(2);
+      c = state_.exchange(2, std::memory_order_acquire);
+    }
+    Counters::wait_end(start);
+  }
+
+  bool try_lock() {
+    std::uint32_t c = 0;
+    if (!state_.compare_exchange_strong(c, 1, std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      return false;
+    }
+    Counters::acquired();
+    return true;
+  }
+
+  void unlock() {
+    if (state_.exchange(0, std::memory_order_release) == 2) {
+      wake_one();
+    }
+  }
+
+ private:
+  static constexpr std::uint32_t MaxSpin = 1000;
+
+  // 与 glibc 的自适应锁相同，按 1/8 的权重逼近本次自旋的次数
+  void adapt(std::uint32_t spun) {
+    const auto s =
+        static_cast<std::int32_t>(spins_.load(std::memory_order_relaxed));
+    const std::int32_t next = s + (static_cast<std::int32_t>(spun) - s) / 8;
+    spins_.store(static_cast<std::uint32_t>(next), std::memory_order_relaxed);
+  }
+
+  // state_ 仍为 expected 时休眠，可能被虚假唤醒
+  void wait(std::uint32_t expected) {
+#if defined(LOCK_POLICY_FUTEX)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&state_),
+            FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    if (state_.load(std::memory_order_relaxed) == expected) {
+      std::this_thread::yield();
+    }
+#endif
+  }
+
+  void wake_one() {
+#if defined(LOCK_POLICY_FUTEX)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&state_),
+            FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+  }
+
+ private:
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                "futex needs a plain 32-bit word");
+  std::atomic<std::uint32_t> state_ = 0;
+  std::atomic<std::uint32_t> spins_ = 0;  // 近期平均的自旋次数，允许竞争写
+};
+
+// MCS 队列锁：等待者把自己的节点接到队尾，只在自己的节点上自旋，
+// 前驱解锁时直接把锁交给它，锁按到达顺序传递，高竞争下既公平又不会
+// 让所有等待者争用同一缓存行。为满足 Lockable，节点取自线程局部的缓存，
+// 持有锁期间记录在锁中，同一线程可以同时持有多个 McsLock
+template <typename Counters = NoLockCounters>
+class McsLock {
+ public:
+  McsLock() = default;
+
+  McsLock(const McsLock&) = delete;
+
+  McsLock& operator=(const McsLock&) = delete;
+
+  void lock() {
+    QNode* n = acquire_node();
+    QNode* pred = tail_.exchange(n, std::memory_order_acq_rel);
+    if (!pred) {
+      owner_ = n;
+      Counters::acquired();
+      return;
+    }
+    const auto start = Counters::wait_begin();
+    n->waiting.store(true, std::memory_order_relaxed);
+    pred->next.store(n, std::memory_order_release);
+    std::size_t spins = 0;
+    while (n->waiting.load(std::memory_order_acquire)) {
+      if (++spins < SpinCount) {
+        cpu_relax();
+      } else {
+        std::this_thread::yield();  // 前驱可能被调度出去
+      }
+    }
+    owner_ = n;
+    Counters::wait_end(start);
+  }
+
+  bool try_lock() {
+    QNode* n = acquire_node();
+    QNode* expected = nullptr;
+    if (!tail_.compare_exchange_strong(expected, n, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      release_node(n);
+      return false;
+    }
+    owner_ = n;
+    Counters::acquired();
+    return true;
+  }
+
+  void unlock() {
+    QNode* n = owner_;
+    QNode* next = n->next.load(std::memory_order_acquire);
+    if (!next) {
+      QNode* expected = n;
+      if (tail_.compare_exchange_strong(expected, nullptr,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+        release_node(n);
+        return;
+      }
+      // 后继已交换了 tail_，等待它链接到 n
+      for (std::size_t spins = 0;
+           !(next = n->next.load(std::memory_order_acquire));) {
+        if (++spins < SpinCount) {
+          cpu_relax();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+    next->waiting.store(false, std::memory_order_release);
+    release_node(n);
+  }
+
+ private:
+  struct alignas(64) QNode {
+    std::atomic<QNode*> next = nullptr;
+    std::atomic<bool> waiting = false;
+  };
+
+  // 节点在线程退出时释放，此时它们都不在任何锁的队列中
+  struct NodeCache {
+    std::vector<QNode*> free;
+
+    ~NodeCache() {
+      for (QNode* n : free) {
+        delete n;
+      }
+    }
+  };
+
+  static constexpr std::size_t SpinCount = 128;
+
+  static NodeCache& cache() {
+    static thread_local NodeCache res;
+    return res;
+  }
+
+  static QNode* acquire_node() {
+    NodeCache& c = cache();
+    if (c.free.empty()) {
+      return new QNode;
+    }
+    QNode* n = c.free.back();
+    c.free.pop_back();
+    n->next.store(nullptr, std::memory_order_relaxed);
+    return n;
+  }
+
+  static void release_node(QNode* n) { cache().free.push_back(n); }
+
+ private:
+  std::atomic<QNode*> tail_ = nullptr;
+  QNode* owner_ = nullptr;  // 只由持有锁的线程访问
+};
+
+// 把只支持独占的锁用作共享锁，读者之间也互斥，
+// 用于要求 SharedMutex 的地方，如 ConcurrentMap 的 ListBucket
+template <typename Lock>
+class ExclusiveAsShared : public Lock {
+ public:
+  void lock_shared() { this->lock(); }
+
+  bool try_lock_shared() { return this->try_lock(); }
+
+  void unlock_shared() { this->unlock(); }
+};
+
+// 与 Mutex 配合使用的条件变量，std::mutex 使用更高效的 std::condition_variable
+template <typename Mutex>
+using ConditionVariableFor =
+    std::conditional_t<std::is_same_v<Mutex, std::mutex>,
+                       std::condition_variable, std::condition_variable_any>;
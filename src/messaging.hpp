@@ -0,0 +1,748 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "node_pool.hpp"
+#include "timer_wheel.hpp"
+
+// Message
+namespace Messaging {
+// 每种消息类型对应一个描述符，描述符的地址即类型 ID，比较 ID 无需 RTTI
+struct MessageType {
+  void (*relocate)(void* dst, void* src) noexcept;  // 移动到 dst 并析构 src
+  void (*destroy)(void* p) noexcept;
+};
+
+inline constexpr std::size_t MessageInlineSize = 112;
+
+// 不超过 MessageInlineSize 且移动不抛异常的消息直接存放在 Message 中，
+// 其他消息从 FixedSizePool 分配，Message 中只存指针
+template <typename Msg>
+struct MessageStorage {
+  static constexpr bool Inline = sizeof(Msg) <= MessageInlineSize &&
+                                 alignof(Msg) <= alignof(std::max_align_t) &&
+                                 std::is_nothrow_move_constructible_v<Msg>;
+
+  template <typename Arg>
+  static void construct(void* p, Arg&& msg) {
+    if constexpr (Inline) {
+      ::new (p) Msg(std::forward<Arg>(msg));
+    } else {
+      PoolAllocator<Msg> a;
+      Msg* t = a.allocate(1);
+      try {
+        ::new (static_cast<void*>(t)) Msg(std::forward<Arg>(msg));
+      } catch (...) {
+        a.deallocate(t, 1);
+        throw;
+      }
+      *static_cast<Msg**>(p) = t;
+    }
+  }
+
+  static Msg& get(void* p) {
+    if constexpr (Inline) {
+      return *std::launder(static_cast<Msg*>(p));
+    } else {
+      return **static_cast<Msg**>(p);
+    }
+  }
+
+  static void relocate(void* dst, void* src) noexcept {
+    if constexpr (Inline) {
+      ::new (dst) Msg(std::move(get(src)));
+      get(src).~Msg();
+    } else {
+      *static_cast<Msg**>(dst) = *static_cast<Msg**>(src);
+    }
+  }
+
+  static void destroy(void* p) noexcept {
+    if constexpr (Inline) {
+      get(p).~Msg();
+    } else {
+      Msg* t = *static_cast<Msg**>(p);
+      t->~Msg();
+      PoolAllocator<Msg>{}.deallocate(t, 1);
+    }
+  }
+};
+
+template <typename Msg>
+inline constexpr MessageType message_type{&MessageStorage<Msg>::relocate,
+                                          &MessageStorage<Msg>::destroy};
+
+// 存放任意类型消息的信封，只能移动
+class Message {
+ public:
+  Message() = default;
+
+  template <typename Msg,
+            typename = std::enable_if_t<
+                !std::is_same_v<std::decay_t<Msg>, Message>>>
+  explicit Message(Msg&& msg) : type_(&message_type<std::decay_t<Msg>>) {
+    MessageStorage<std::decay_t<Msg>>::construct(storage_,
+                                                 std::forward<Msg>(msg));
+  }
+
+  Message(Message&& rhs) noexcept : type_(rhs.type_) {
+    if (type_) {
+      type_->relocate(storage_, rhs.storage_);
+      rhs.type_ = nullptr;
+    }
+  }
+
+  Message& operator=(Message&& rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      if (rhs.type_) {
+        rhs.type_->relocate(storage_, rhs.storage_);
+        type_ = std::exchange(rhs.type_, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  ~Message() { reset(); }
+
+  template <typename Msg>
+  bool is() const {
+    return type_ == &message_type<Msg>;
+  }
+
+  // 要求 is<Msg>() 为 true
+  template <typename Msg>
+  Msg& get() {
+    return MessageStorage<Msg>::get(storage_);
+  }
+
+  bool empty() const { return type_ == nullptr; }
+
+ private:
+  void reset() {
+    if (type_) {
+      type_->destroy(storage_);
+      type_ = nullptr;
+    }
+  }
+
+ private:
+  const MessageType* type_ = nullptr;
+  alignas(std::max_align_t) unsigned char storage_[MessageInlineSize];
+};
+}  // namespace Messaging
+
+// MessageQueue
+namespace Messaging {
+class CloseQueue {};  // 用于关闭队列的消息，收到后等同于调用 close
+
+// wait_for 和 wait_until 超时后收到的消息
+struct Timeout {};
+
+// 有界队列已满时 push 的行为
+enum class OverflowPolicy {
+  Block,       // 等待接收者取走消息，执行器上的接收者不应以此方式互相发送
+  DropOldest,  // 丢弃队列中最早的消息
+  Fail,        // 拒绝新消息，push 返回 false
+};
+
+struct MailboxOptions {
+  std::size_t capacity = 0;  // 最多缓存的消息数，0 表示不限制
+  OverflowPolicy overflow = OverflowPolicy::Block;
+};
+
+enum class DispatchStatus {
+  Handled,   // 处理了一条消息
+  Deferred,  // 异步模式下没有已到达的匹配消息，处理链已保存
+  Closed,    // 队列已关闭且没有剩余消息
+  TimedOut,  // 超时且处理链中没有 handle<Timeout>
+};
+
+// 异步模式下状态函数返回后仍在等待消息的处理链，见 MessageQueue::run_on
+class PendingHandlers {
+ public:
+  virtual ~PendingHandlers() = default;
+
+  virtual bool dispatch(Message& msg) = 0;  // 返回 false 表示消息未被处理
+};
+
+// 消息存放在环形缓冲区中，缓冲区满时容量翻倍，之后不再缩小，
+// 因此稳定状态下 push 和 wait_and_pop 都不分配内存。
+// 指定 capacity 后缓冲区不超过 capacity 向上取整到 2 的幂，
+// 过载时按 OverflowPolicy 处理，内存占用有上界。
+// 超时由共享的 TimerWheel 触发，每个队列只有一个定时器，不额外占用线程。
+// 默认由接收者线程阻塞在 wait_and_pop 上。调用 run_on 后转为异步模式：
+// 不再占用线程，消息到达时才把队列调度到执行器（如 ThreadPool）上，
+// 每次调度最多处理 batch 条消息，之后重新排队，让其他队列也能得到执行
+class MessageQueue {
+ public:
+  static constexpr std::size_t DefaultBatch = 64;
+
+  explicit MessageQueue(const MailboxOptions& options = MailboxOptions{})
+      : buf_(InitialCapacity), options_(options) {}
+
+  // 定时器回调会访问队列，必须先取消
+  ~MessageQueue() { clear_deadline(); }
+
+  // 队列已关闭或按 Fail 策略拒绝时返回 false，DropOldest 总是成功
+  template <typename Msg>
+  bool push(Msg&& msg) {
+    Message m(std::forward<Msg>(msg));  // 在锁外复制消息
+    Message dropped;                    // 在锁外析构被丢弃的消息
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> l(m_);
+      if (!closed_ && full()) {
+        switch (options_.overflow) {
+          case OverflowPolicy::Block:
+            ++blocked_;
+            not_full_.wait(l, [&] { return closed_ || !full(); });
+            --blocked_;
+            break;
+          case OverflowPolicy::DropOldest:
+            dropped = pop_front();
+            break;
+          case OverflowPolicy::Fail:
+            return false;
+        }
+      }
+      if (closed_) {
+        return false;
+      }
+      if (size_ == buf_.size()) {
+        grow();
+      }
+      buf_[(head_ + size_) & (buf_.size() - 1)] = std::move(m);
+      ++size_;
+      schedule = claim_schedule();
+    }
+    if (schedule) {
+      post_();
+    } else {
+      cv_.notify_one();  // 每条消息只会被一个接收者取走
+    }
+    return true;
+  }
+
+  // 队列已关闭且为空时返回 false。超时后 Timeout 先于队列中的消息取出
+  bool wait_and_pop(Message& res) {
+    std::unique_lock<std::mutex> l(m_);
+    cv_.wait(l, [&] { return size_ > 0 || closed_ || timed_out_; });
+    return pop(res);
+  }
+
+  bool try_pop(Message& res) {
+    std::lock_guard<std::mutex> l(m_);
+    return pop(res);
+  }
+
+  // 只由接收者调用。deadline 之后 pop 得到 Timeout，直到 clear_deadline
+  void set_deadline(TimerWheel::Clock::time_point deadline) {
+    {
+      std::lock_guard<std::mutex> l(m_);
+      timed_out_ = false;
+    }
+    has_deadline_ = true;
+    TimerWheel::shared().schedule(timer_, deadline);
+  }
+
+  void clear_deadline() {
+    if (!has_deadline_) {
+      return;
+    }
+    has_deadline_ = false;
+    TimerWheel::shared().cancel(timer_);  // 返回后回调不会再设置 timed_out_
+    std::lock_guard<std::mutex> l(m_);
+    timed_out_ = false;
+  }
+
+  // 之后的 push 都返回 false，阻塞在 push 中的发送者也返回 false。
+  // 已入队的消息仍会被取走，取完后接收者得到 DispatchStatus::Closed
+  void close() {
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> l(m_);
+      if (closed_) {
+        return;
+      }
+      closed_ = true;
+      schedule = claim_schedule();
+    }
+    not_full_.notify_all();
+    if (schedule) {
+      post_();
+    } else {
+      cv_.notify_all();
+    }
+  }
+
+  // 已关闭且没有剩余消息
+  bool drained() {
+    std::lock_guard<std::mutex> l(m_);
+    return closed_ && size_ == 0;
+  }
+
+  // 转为异步模式。step 相当于阻塞模式下 run 循环的一次迭代，
+  // 通常是调用当前的状态函数，状态函数中的 wait() 不会阻塞：
+  // 已有匹配的消息时直接处理，否则把处理链保存下来，在消息到达时处理。
+  // 因此处理函数不能引用状态函数的局部变量。
+  // 队列关闭且剩余消息处理完后停止调度，wait_stopped 返回
+  template <typename Executor>
+  void run_on(Executor& ex, std::function<void()> step,
+              std::size_t batch = DefaultBatch) {
+    step_ = std::move(step);
+    batch_ = batch;
+    post_ = [this, &ex] { ex.post([this] { run_turn(); }); };
+    {
+      std::lock_guard<std::mutex> l(m_);
+      async_ = scheduled_ = true;
+    }
+    post_();
+  }
+
+  bool is_async() const { return async_; }
+
+  // 异步模式下由处理链调用
+  void set_pending(std::unique_ptr<PendingHandlers> pending) {
+    pending_ = std::move(pending);
+  }
+
+  void wait_stopped() {
+    std::unique_lock<std::mutex> l(m_);
+    cv_.wait(l, [&] { return stopped_ && !scheduled_; });
+  }
+
+ private:
+  static constexpr std::size_t InitialCapacity = 16;  // 必须为 2 的幂
+
+  // 在 TimerWheel 的线程上执行，不能抛出异常。执行器已关闭时 post_ 抛出异常，
+  // 此时不会再有 run_turn，停止调度，使 wait_stopped 返回
+  static void expire(void* p) noexcept {
+    MessageQueue* q = static_cast<MessageQueue*>(p);
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> l(q->m_);
+      q->timed_out_ = true;
+      schedule = q->claim_schedule();
+    }
+    if (!schedule) {
+      q->cv_.notify_all();
+      return;
+    }
+    try {
+      q->post_();
+    } catch (...) {
+      std::lock_guard<std::mutex> l(q->m_);
+      q->scheduled_ = false;
+      q->stopped_ = true;
+      q->cv_.notify_all();
+    }
+  }
+
+  // 以下函数的调用者持有 m_
+  bool pop(Message& res) {
+    if (timed_out_) {
+      timed_out_ = false;
+      res = Message(Timeout{});
+      return true;
+    }
+    if (size_ == 0) {
+      return false;
+    }
+    res = pop_front();
+    return true;
+  }
+
+  bool full() const {
+    return options_.capacity != 0 && size_ >= options_.capacity;
+  }
+
+  Message pop_front() {
+    Message res = std::move(buf_[head_]);
+    head_ = (head_ + 1) & (buf_.size() - 1);
+    --size_;
+    if (blocked_ > 0) {
+      not_full_.notify_one();
+    }
+    return res;
+  }
+
+  void grow() {
+    std::vector<Message> buf(buf_.size() * 2);
+    for (std::size_t i = 0; i < size_; ++i) {
+      buf[i] = std::move(buf_[(head_ + i) & (buf_.size() - 1)]);
+    }
+    buf_.swap(buf);
+    head_ = 0;
+  }
+
+  // 返回 true 时由调用者在锁外调用 post_
+  bool claim_schedule() {
+    if (async_ && !scheduled_ && !stopped_) {
+      scheduled_ = true;
+      return true;
+    }
+    return false;
+  }
+
+  // 同一时刻只有一个 run_turn 在执行，step_ 和 pending_ 无需加锁
+  void run_turn() {
+    try {
+      for (std::size_t i = 0; i < batch_; ++i) {
+        if (!pending_) {  // 执行状态函数，直到它开始等待消息
+          step_();
+          if (!pending_ && drained()) {
+            break;
+          }
+          continue;
+        }
+        Message msg;
+        if (!try_pop(msg)) {
+          break;
+        }
+        if (pending_->dispatch(msg)) {
+          pending_.reset();
+          clear_deadline();
+        } else if (msg.is<Timeout>()) {  // 没有处理超时，重新执行状态函数
+          pending_.reset();
+          clear_deadline();
+        } else if (msg.is<CloseQueue>()) {
+          close();
+        }
+      }
+    } catch (const CloseQueue&) {  // 处理函数抛出 CloseQueue 时丢弃剩余消息
+      pending_.reset();
+      close();
+      std::lock_guard<std::mutex> l(m_);
+      for (Message& m : buf_) {
+        m = Message();
+      }
+      head_ = size_ = 0;
+    }
+    {
+      std::lock_guard<std::mutex> l(m_);
+      // 正在等待消息且队列为空时暂停调度，下一条消息到达或超时时重新调度
+      if ((closed_ || pending_) && size_ == 0 && !timed_out_) {
+        scheduled_ = false;
+        if (closed_) {
+          stopped_ = true;
+          cv_.notify_all();
+        }
+        return;
+      }
+    }
+    post_();
+  }
+
+ private:
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::condition_variable not_full_;  // 等待 Block 策略的有界队列出现空位
+  std::vector<Message> buf_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+  std::size_t blocked_ = 0;  // 阻塞在 push 中的发送者数
+  bool closed_ = false;
+  bool timed_out_ = false;
+  const MailboxOptions options_;
+  TimerWheel::Timer timer_{&MessageQueue::expire, this};
+  bool has_deadline_ = false;  // 只由接收者访问
+  // 以下用于异步模式，async_ 在 run_on 之后不再改变
+  bool async_ = false;
+  bool scheduled_ = false;  // 已提交给执行器或正在执行，保护于 m_
+  bool stopped_ = false;    // 保护于 m_
+  std::size_t batch_ = DefaultBatch;
+  std::function<void()> step_;
+  std::function<void()> post_;
+  std::unique_ptr<PendingHandlers> pending_;
+};
+}  // namespace Messaging
+
+//  TemplateDispatcher
+namespace Messaging {
+// 异步模式下保存的处理链，从 TemplateDispatcher 链中移出所有处理函数
+template <typename Prev, typename Msg, typename F>
+struct StoredHandlers {
+  Prev prev;
+  F f;
+
+  bool dispatch(Message& msg) {
+    if (msg.is<Msg>()) {
+      f(msg.get<Msg>());
+      return true;
+    }
+    return prev.dispatch(msg);
+  }
+};
+
+struct StoredClose {
+  bool dispatch(Message&) { return false; }
+};
+
+template <typename Stored>
+class StoredPendingHandlers : public PendingHandlers {
+ public:
+  explicit StoredPendingHandlers(Stored&& s) : s_(std::move(s)) {}
+
+  bool dispatch(Message& msg) override { return s_.dispatch(msg); }
+
+ private:
+  Stored s_;
+};
+
+// 两种调度器共用的等待逻辑。未被处理的 CloseQueue 关闭队列，
+// 队列中剩余的消息仍由当前处理链处理
+struct DispatchLoop {
+  template <typename D>
+  static DispatchStatus run(MessageQueue* q, D& d) {
+    const DispatchStatus res =
+        q->is_async() ? run_async(q, d) : run_blocking(q, d);
+    if (res != DispatchStatus::Deferred) {  // 等待已结束
+      q->clear_deadline();
+    }
+    return res;
+  }
+
+  template <typename D>
+  static DispatchStatus run_blocking(MessageQueue* q, D& d) {
+    Message msg;
+    while (q->wait_and_pop(msg)) {
+      if (d.dispatch(msg)) {
+        return DispatchStatus::Handled;
+      }
+      if (msg.is<Timeout>()) {
+        return DispatchStatus::TimedOut;
+      }
+      if (msg.is<CloseQueue>()) {
+        q->close();
+      }
+    }
+    return DispatchStatus::Closed;
+  }
+
+  // 已有匹配的消息时直接处理，否则把处理链交给 q 保存
+  template <typename D>
+  static DispatchStatus run_async(MessageQueue* q, D& d) {
+    Message msg;
+    while (q->try_pop(msg)) {
+      if (d.dispatch(msg)) {
+        return DispatchStatus::Handled;
+      }
+      if (msg.is<Timeout>()) {
+        return DispatchStatus::TimedOut;
+      }
+      if (msg.is<CloseQueue>()) {
+        q->close();
+      }
+    }
+    if (q->drained()) {
+      return DispatchStatus::Closed;
+    }
+    using Stored = typename D::Stored;
+    q->set_pending(std::make_unique<StoredPendingHandlers<Stored>>(d.take()));
+    return DispatchStatus::Deferred;
+  }
+};
+
+// 每个 TemplateDispatcher 处理一种消息，链上的比较都是内联的指针比较
+template <typename PreviousDispatcher, typename Msg, typename F>
+class TemplateDispatcher {
+ public:
+  TemplateDispatcher(const TemplateDispatcher&) = delete;
+
+  TemplateDispatcher& operator=(const TemplateDispatcher&) = delete;
+
+  TemplateDispatcher(TemplateDispatcher&& rhs) noexcept
+      : q_(rhs.q_),
+        prev_(rhs.prev_),
+        f_(std::move(rhs.f_)),
+        chained_(rhs.chained_) {
+    rhs.chained_ = true;
+  }
+
+  TemplateDispatcher(MessageQueue* q, PreviousDispatcher* prev, F&& f)
+      : q_(q), prev_(prev), f_(std::forward<F>(f)) {
+    prev->chained_ = true;
+  }
+
+  template <typename OtherMsg, typename OtherF>
+  TemplateDispatcher<TemplateDispatcher, OtherMsg, OtherF> handle(OtherF&& f) {
+    return TemplateDispatcher<TemplateDispatcher, OtherMsg, OtherF>(
+        q_, this, std::forward<OtherF>(f));
+  }
+
+  // 结束处理链并立即调度，队列关闭时返回 Closed 而不是抛出 CloseQueue
+  DispatchStatus receive() {
+    chained_ = true;
+    return DispatchLoop::run(q_, *this);
+  }
+
+  // 所有调度器都可能抛出异常。
+  // 未调用 receive 时在析构函数中完成任务调度，阻塞模式下队列关闭时抛出
+  // CloseQueue，异步模式下由 MessageQueue 停止调度，不抛出异常
+  ~TemplateDispatcher() noexcept(false) {
+    if (!chained_ && DispatchLoop::run(q_, *this) == DispatchStatus::Closed &&
+        !q_->is_async()) {
+      throw CloseQueue();
+    }
+  }
+
+ private:
+  template <typename Dispatcher, typename OtherMsg, typename OtherF>
+  friend class TemplateDispatcher;  // TemplateDispatcher 实例互为友元
+
+  friend struct DispatchLoop;
+
+  using Stored = StoredHandlers<typename PreviousDispatcher::Stored, Msg,
+                                std::decay_t<F>>;
+
+  // F 为引用时复制处理函数，否则移动
+  Stored take() { return Stored{prev_->take(), static_cast<F&&>(f_)}; }
+
+  bool dispatch(Message& msg) {
+    if (msg.is<Msg>()) {
+      f_(msg.get<Msg>());
+      return true;
+    }
+    // 如果消息类型不匹配，则链接到前一个 dispatcher
+    return prev_->dispatch(msg);
+  }
+
+ private:
+  MessageQueue* q_ = nullptr;
+  PreviousDispatcher* prev_ = nullptr;
+  F f_;
+  bool chained_ = false;
+};
+}  // namespace Messaging
+
+// Dispatcher
+namespace Messaging {
+class Dispatcher {
+ public:
+  Dispatcher(const Dispatcher&) = delete;
+
+  Dispatcher& operator=(const Dispatcher&) = delete;
+
+  Dispatcher(Dispatcher&& rhs) noexcept : q_(rhs.q_), chained_(rhs.chained_) {
+    rhs.chained_ = true;
+  }
+
+  explicit Dispatcher(MessageQueue* q) : q_(q) {}
+
+  template <typename Msg, typename F>
+  TemplateDispatcher<Dispatcher, Msg, F> handle(F&& f) {
+    // 用 TemplateDispatcher 处理特定类型的消息
+    return TemplateDispatcher<Dispatcher, Msg, F>(q_, this, std::forward<F>(f));
+  }
+
+  // 没有处理函数，不会得到 Handled
+  DispatchStatus receive() {
+    chained_ = true;
+    return DispatchLoop::run(q_, *this);
+  }
+
+  ~Dispatcher() noexcept(false) {  // 可能抛出 CloseQueue 异常
+    if (!chained_ && DispatchLoop::run(q_, *this) == DispatchStatus::Closed &&
+        !q_->is_async()) {  // 从 Receiver::wait 返回的实例会马上被析构
+      throw CloseQueue();
+    }
+  }
+
+ private:
+  template <typename Dispatcher, typename Msg, typename F>
+  friend class TemplateDispatcher;
+
+  friend struct DispatchLoop;
+
+  using Stored = StoredClose;
+
+  Stored take() { return Stored{}; }
+
+  // 返回 false 表示消息未被处理，CloseQueue 由 DispatchLoop 处理
+  bool dispatch(Message&) { return false; }
+
+ private:
+  MessageQueue* q_ = nullptr;
+  bool chained_ = false;
+};
+}  // namespace Messaging
+
+// Sender
+namespace Messaging {
+class Sender {
+ public:
+  Sender() = default;
+
+  explicit Sender(MessageQueue* q) : q_(q) {}
+
+  // 队列已关闭或有界队列拒绝消息时返回 false，见 OverflowPolicy
+  template <typename Msg>
+  bool send(Msg&& msg) {
+    return q_ && q_->push(std::forward<Msg>(msg));
+  }
+
+  void close() {
+    if (q_) {
+      q_->close();
+    }
+  }
+
+ private:
+  MessageQueue* q_ = nullptr;
+};
+}  // namespace Messaging
+
+// Receiver
+namespace Messaging {
+class Receiver {
+ public:
+  explicit Receiver(const MailboxOptions& options = MailboxOptions{})
+      : q_(options) {}
+
+  operator Sender() {  // 允许隐式转换为 Sender
+    return Sender(&q_);
+  }
+
+  Dispatcher wait() {  // 等待对队列的调度
+    return Dispatcher(&q_);
+  }
+
+  // 与 wait 相同，但到 deadline 仍没有消息被处理时收到 Timeout，
+  // 处理链中没有 handle<Timeout> 时 receive 返回 DispatchStatus::TimedOut
+  Dispatcher wait_until(TimerWheel::Clock::time_point deadline) {
+    q_.set_deadline(deadline);
+    return Dispatcher(&q_);
+  }
+
+  template <typename Rep, typename Period>
+  Dispatcher wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+    return wait_until(TimerWheel::Clock::now() + timeout);
+  }
+
+  // 不再接收新消息，已入队的消息处理完后 receive 返回 Closed
+  void close() { q_.close(); }
+
+  // 在执行器上异步运行，见 MessageQueue::run_on
+  template <typename Executor>
+  void run_on(Executor& ex, std::function<void()> step,
+              std::size_t batch = MessageQueue::DefaultBatch) {
+    q_.run_on(ex, std::move(step), batch);
+  }
+
+  // 等待异步运行的接收者关闭并处理完剩余消息
+  void wait_stopped() { q_.wait_stopped(); }
+
+ private:
+  MessageQueue q_;
+};
+}  // namespace Messaging
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bit_ops.hpp"
+
+// 容器和线程池的运行时指标，默认关闭。关闭时所有指标都是空类，
+// 构造是常量初始化，记录是空函数，没有任何开销。
+// 定义 CONCURRENCY_METRICS 为 1 开启，所有翻译单元必须使用相同的设置。
+// 指标是函数内的静态对象，构造时登记到 MetricsRegistry，
+// 计数按线程分片累加，记录一次只需一到两次 relaxed 原子加法，
+// 读取时才汇总所有分片
+#if !defined(CONCURRENCY_METRICS)
+#define CONCURRENCY_METRICS 0
+#endif
+
+class ShardedCounter;
+class Histogram;
+
+// Histogram 在某一时刻的汇总
+struct HistogramSnapshot {
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::vector<std::uint64_t> buckets;  // 桶的划分见 Histogram
+
+  // 第 p（0 <= p <= 1）分位数所在桶的中点，没有记录时返回 0
+  std::uint64_t percentile(double p) const;
+
+  double mean() const {
+    return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+  }
+
+  void merge(const HistogramSnapshot& rhs);
+};
+
+// 所有指标的登记处。name 与 labels 都相同的指标在读取时合并，
+// 如不同模板实例中的同一指标。labels 的格式为 key="value",...
+class MetricsRegistry {
+ public:
+  // 不在进程退出时析构，静态的指标对象可能析构得更晚
+  static MetricsRegistry& instance() {
+    static MetricsRegistry* res = new MetricsRegistry;
+    return *res;
+  }
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  std::uint64_t counter_value(std::string_view name,
+                              std::string_view labels = {}) const;
+
+  HistogramSnapshot histogram_snapshot(std::string_view name,
+                                       std::string_view labels = {}) const;
+
+  // Prometheus 文本格式，直方图输出为 summary，
+  // 包括 0.5、0.9、0.99、0.999 分位数及 _sum、_count
+  std::string scrape() const;
+
+ private:
+  friend class ShardedCounter;
+  friend class Histogram;
+
+  template <typename Metric>
+  struct Entry {
+    std::string name;
+    std::string labels;
+    const Metric* metric;
+  };
+
+  MetricsRegistry() = default;
+
+  template <typename Metric>
+  static void add(std::vector<Entry<Metric>>& entries, std::string_view name,
+                  std::string_view labels, const Metric* metric) {
+    entries.push_back(
+        Entry<Metric>{std::string(name), std::string(labels), metric});
+  }
+
+  template <typename Metric>
+  static void remove(std::vector<Entry<Metric>>& entries,
+                     const Metric* metric) {
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](auto& e) { return e.metric == metric; }),
+                  entries.end());
+  }
+
+ private:
+  mutable std::mutex m_;
+  std::vector<Entry<ShardedCounter>> counters_;
+  std::vector<Entry<Histogram>> histograms_;
+};
+
+#if CONCURRENCY_METRICS
+// 线程按首次记录的顺序轮流分配到分片，线程数不多于分片数时互不共享缓存行
+inline std::size_t metric_shard_index() {
+  static std::atomic<std::size_t> next = 0;
+  static thread_local const std::size_t res =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return res;
+}
+#endif
+
+// 单调递增的计数。需要当前值的量用两个计数表示，
+// 如待回收节点数为 retired_total 与 reclaimed_total 之差
+class ShardedCounter {
+ public:
+#if CONCURRENCY_METRICS
+  explicit ShardedCounter(std::string_view name,
+                          std::string_view labels = {}) {
+    MetricsRegistry& r = MetricsRegistry::instance();
+    std::lock_guard<std::mutex> l(r.m_);
+    MetricsRegistry::add(r.counters_, name, labels, this);
+  }
+
+  ~ShardedCounter() {
+    MetricsRegistry& r = MetricsRegistry::instance();
+    std::lock_guard<std::mutex> l(r.m_);
+    MetricsRegistry::remove(r.counters_, this);
+  }
+#else
+  // 参数为 std::string_view 时 GCC 不做常量初始化，每次访问都要检查初始化标志
+  constexpr explicit ShardedCounter(const char*, const char* = "") {}
+#endif
+
+  ShardedCounter(const ShardedCounter&) = delete;
+
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  void add([[maybe_unused]] std::uint64_t n = 1) {
+#if CONCURRENCY_METRICS
+    shards_[metric_shard_index() % Shards].v.fetch_add(
+        n, std::memory_order_relaxed);
+#endif
+  }
+
+  std::uint64_t value() const {
+    std::uint64_t res = 0;
+#if CONCURRENCY_METRICS
+    for (const Shard& s : shards_) {
+      res += s.v.load(std::memory_order_relaxed);
+    }
+#endif
+    return res;
+  }
+
+#if CONCURRENCY_METRICS
+ private:
+  static constexpr std::size_t Shards = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> v = 0;
+  };
+
+ private:
+  Shard shards_[Shards];
+#endif
+};
+
+// HDR 式的对数线性直方图：小于 8 的值各占一个桶，此后每个 2 的幂区间
+// 分为 8 个等宽的桶，桶宽不超过值的 1/8，取中点的相对误差不超过 1/16。
+// 不小于 2^48 的值都计入最后一个桶，以纳秒为单位时约为 78 小时
+class Histogram {
+ public:
+  static constexpr std::size_t SubBits = 3;
+  static constexpr std::size_t SubBuckets = 1 << SubBits;
+  static constexpr std::size_t MaxBits = 48;
+  static constexpr std::size_t BucketCount =
+      (MaxBits - SubBits + 1) * SubBuckets;
+
+#if CONCURRENCY_METRICS
+  explicit Histogram(std::string_view name,
+                     std::string_view labels = {}) {
+    MetricsRegistry& r = MetricsRegistry::instance();
+    std::lock_guard<std::mutex> l(r.m_);
+    MetricsRegistry::add(r.histograms_, name, labels, this);
+  }
+
+  ~Histogram() {
+    MetricsRegistry& r = MetricsRegistry::instance();
+    std::lock_guard<std::mutex> l(r.m_);
+    MetricsRegistry::remove(r.histograms_, this);
+  }
+#else
+  constexpr explicit Histogram(const char*, const char* = "") {}
+#endif
+
+  Histogram(const Histogram&) = delete;
+
+  Histogram& operator=(const Histogram&) = delete;
+
+  static std::size_t bucket_index(std::uint64_t v) {
+    if (v < SubBuckets) {
+      return static_cast<std::size_t>(v);
+    }
+    const std::size_t e = highest_bit(v);
+    if (e >= MaxBits) {
+      return BucketCount - 1;
+    }
+    return (e - SubBits + 1) * SubBuckets +
+           static_cast<std::size_t>(v >> (e - SubBits) & (SubBuckets - 1));
+  }
+
+  // 桶 i 的范围为 [bucket_lower(i), bucket_lower(i + 1))
+  static std::uint64_t bucket_lower(std::size_t i) {
+    if (i < SubBuckets) {
+      return i;
+    }
+    const std::size_t e = i / SubBuckets + SubBits - 1;
+    return (SubBuckets + i % SubBuckets) << (e - SubBits);
+  }
+
+  void record([[maybe_unused]] std::uint64_t v) {
+#if CONCURRENCY_METRICS
+    Shard& s = shards_[metric_shard_index() % Shards];
+    s.buckets[bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(v, std::memory_order_relaxed);
+#endif
+  }
+
+  // 记录从 start 到现在的纳秒数，关闭时不读时钟
+  void record_since(
+      [[maybe_unused]] std::chrono::steady_clock::time_point start) {
+#if CONCURRENCY_METRICS
+    const auto d = std::chrono::steady_clock::now() - start;
+    record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+#endif
+  }
+
+  HistogramSnapshot snapshot() const {
+    HistogramSnapshot res;
+#if CONCURRENCY_METRICS
+    res.buckets.assign(BucketCount, 0);
+    for (const Shard& s : shards_) {
+      res.sum += s.sum.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < BucketCount; ++i) {
+        res.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+      }
+    }
+    for (std::uint64_t n : res.buckets) {
+      res.count += n;
+    }
+#endif
+    return res;
+  }
+
+#if CONCURRENCY_METRICS
+ private:
+  static constexpr std::size_t Shards = 8;
+
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> sum = 0;
+    std::atomic<std::uint64_t> buckets[BucketCount] = {};
+  };
+
+ private:
+  Shard shards_[Shards];
+#endif
+};
+
+// 一个锁的竞争指标：<prefix>_acquisitions_total、<prefix>_contended_total，
+// 以及需要等待时的等待时间 <prefix>_wait_ns
+class LockMetrics {
+ public:
+#if CONCURRENCY_METRICS
+  explicit LockMetrics(std::string_view prefix, std::string_view labels = {})
+      : acquisitions_(std::string(prefix) + "_acquisitions_total", labels),
+        contended_(std::string(prefix) + "_contended_total", labels),
+        wait_ns_(std::string(prefix) + "_wait_ns", labels) {}
+#else
+  constexpr explicit LockMetrics(const char*, const char* = "") {}
+#endif
+
+  LockMetrics(const LockMetrics&) = delete;
+
+  LockMetrics& operator=(const LockMetrics&) = delete;
+
+  // 开启时先 try_lock，失败才读时钟，无竞争时只多一次计数
+  template <typename Mutex>
+  void lock(Mutex& m) {
+#if CONCURRENCY_METRICS
+    acquisitions_.add();
+    if (m.try_lock()) {
+      return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    m.lock();
+    contended_.add();
+    wait_ns_.record_since(start);
+#else
+    m.lock();
+#endif
+  }
+
+#if CONCURRENCY_METRICS
+ private:
+  ShardedCounter acquisitions_;
+  ShardedCounter contended_;
+  Histogram wait_ns_;
+#endif
+};
+
+// 与 std::lock_guard 相同，加锁时记录到 metrics
+template <typename Mutex>
+class MeteredLockGuard {
+ public:
+  MeteredLockGuard(Mutex& m, LockMetrics& metrics) : m_(m) { metrics.lock(m); }
+
+  ~MeteredLockGuard() { m_.unlock(); }
+
+  MeteredLockGuard(const MeteredLockGuard&) = delete;
+
+  MeteredLockGuard& operator=(const MeteredLockGuard&) = delete;
+
+ private:
+  Mutex& m_;
+};
+
+inline std::uint64_t HistogramSnapshot::percentile(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(p * static_cast<double>(count) + 0.5));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      const std::uint64_t lo = Histogram::bucket_lower(i);
+      const std::uint64_t hi = Histogram::bucket_lower(i + 1);
+      return lo + (hi - lo) / 2;
+    }
+  }
+  return Histogram::bucket_lower(buckets.size() - 1);
+}
+
+inline void HistogramSnapshot::merge(const HistogramSnapshot& rhs) {
+  count += rhs.count;
+  sum += rhs.sum;
+  if (buckets.size() < rhs.buckets.size()) {
+    buckets.resize(rhs.buckets.size());
+  }
+  for (std::size_t i = 0; i < rhs.buckets.size(); ++i) {
+    buckets[i] += rhs.buckets[i];
+  }
+}
+
+inline std::uint64_t MetricsRegistry::counter_value(
+    std::string_view name, std::string_view labels) const {
+  std::lock_guard<std::mutex> l(m_);
+  std::uint64_t res = 0;
+  for (const auto& e : counters_) {
+    if (e.name == name && e.labels == labels) {
+      res += e.metric->value();
+    }
+  }
+  return res;
+}
+
+inline HistogramSnapshot MetricsRegistry::histogram_snapshot(
+    std::string_view name, std::string_view labels) const {
+  std::lock_guard<std::mutex> l(m_);
+  HistogramSnapshot res;
+  for (const auto& e : histograms_) {
+    if (e.name == name && e.labels == labels) {
+      res.merge(e.metric->snapshot());
+    }
+  }
+  return res;
+}
+
+inline std::string MetricsRegistry::scrape() const {
+  using Key = std::pair<std::string, std::string>;
+  std::map<Key, std::uint64_t> counters;
+  std::map<Key, HistogramSnapshot> histograms;
+  {
+    std::lock_guard<std::mutex> l(m_);
+    for (const auto& e : counters_) {
+      counters[Key(e.name, e.labels)] += e.metric->value();
+    }
+    for (const auto& e : histograms_) {
+      histograms[Key(e.name, e.labels)].merge(e.metric->snapshot());
+    }
+  }
+  std::string res;
+  auto line = [&](const std::string& name, const std::string& labels,
+                  const std::string& extra, std::uint64_t v) {
+    res += name;
+    if (!labels.empty() || !extra.empty()) {
+      res += '{';
+      res += labels;
+      res += !labels.empty() && !extra.empty() ? "," : "";
+      res += extra;
+      res += '}';
+    }
+    res += ' ';
+    res += std::to_string(v);
+    res += '\n';
+  };
+  const std::string* last = nullptr;  // 同名的指标只输出一次类型
+  for (const auto& [key, v] : counters) {
+    if (!last || *last != key.first) {
+      res += "# TYPE " + key.first + " counter\n";
+      last = &key.first;
+    }
+    line(key.first, key.second, "", v);
+  }
+  last = nullptr;
+  for (const auto& [key, h] : histograms) {
+    if (!last || *last != key.first) {
+      res += "# TYPE " + key.first + " summary\n";
+      last = &key.first;
+    }
+    static constexpr std::pair<double, const char*> Quantiles[] = {
+        {0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+    for (const auto& [q, text] : Quantiles) {
+      line(key.first, key.second, std::string("quantile=\"") + text + "\"",
+           h.percentile(q));
+    }
+    line(key.first + "_sum", key.second, "", h.sum);
+    line(key.first + "_count", key.second, "", h.count);
+  }
+  return res;
+}
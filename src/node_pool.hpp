@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// 固定大小内存块的池，每个线程有一个本地空闲链表，分配和释放都不加锁。
+// 本地链表过长时把一批内存块归还全局池，本地链表为空时从全局池取回一批，
+// 全局池也为空才向系统申请一整块内存，因此稳定状态下不会调用 malloc。
+// 内存只在程序退出时释放给系统
+template <std::size_t Size, std::size_t Align>
+class FixedSizePool {
+ public:
+  static void* allocate() {
+    Local& local = local_pool();
+    if (!local.head) {
+      refill(local);
+    }
+    Block* res = local.head;
+    local.head = res->next;
+    --local.cnt;
+    return res;
+  }
+
+  static void deallocate(void* p) noexcept {
+    Local& local = local_pool();
+    Block* b = static_cast<Block*>(p);
+    b->next = local.head;
+    local.head = b;
+    if (++local.cnt >= 2 * BatchSize) {  // 保留一批，避免在阈值附近反复归还
+      give_back(local, BatchSize);
+    }
+  }
+
+ private:
+  static constexpr std::size_t BatchSize = 64;
+
+  struct Block {
+    Block* next;
+  };
+
+  static constexpr std::size_t BlockAlign =
+      Align > alignof(Block) ? Align : alignof(Block);
+  static constexpr std::size_t BlockSize =
+      ((Size > sizeof(Block) ? Size : sizeof(Block)) + BlockAlign - 1) /
+      BlockAlign * BlockAlign;
+
+  struct Batch {
+    Block* head;
+    std::size_t cnt;
+  };
+
+  struct Global {
+    std::mutex m;
+    std::vector<Batch> batches;
+    std::vector<void*> chunks;  // 向系统申请的内存
+
+    ~Global() {
+      for (void* p : chunks) {
+        ::operator delete(p, std::align_val_t{BlockAlign});
+      }
+    }
+  };
+
+  struct Local {
+    Block* head = nullptr;
+    std::size_t cnt = 0;
+
+    ~Local() {  // 线程退出时归还所有内存块
+      if (cnt > 0) {
+        give_back(*this, cnt);
+      }
+    }
+  };
+
+  // 线程局部对象都先于静态对象析构，因此 Local 析构时 Global 仍然有效
+  static Global& global_pool() {
+    static Global res;
+    return res;
+  }
+
+  static Local& local_pool() {
+    static thread_local Local res;
+    return res;
+  }
+
+  static void refill(Local& local) {
+    Global& global = global_pool();
+    {
+      std::lock_guard<std::mutex> l(global.m);
+      if (!global.batches.empty()) {
+        local.head = global.batches.back().head;
+        local.cnt = global.batches.back().cnt;
+        global.batches.pop_back();
+        return;
+      }
+    }
+    auto chunk = static_cast<unsigned char*>(::operator new(
+        BlockSize * BatchSize, std::align_val_t{BlockAlign}));
+    for (std::size_t i = 0; i < BatchSize; ++i) {
+      Block* b = reinterpret_cast<Block*>(chunk + i * BlockSize);
+      b->next = local.head;
+      local.head = b;
+    }
+    local.cnt = BatchSize;
+    std::lock_guard<std::mutex> l(global.m);
+    global.chunks.emplace_back(chunk);
+  }
+
+  // 从本地链表头部摘下 n 个内存块交给全局池
+  static void give_back(Local& local, std::size_t n) {
+    Block* first = local.head;
+    Block* last = first;
+    for (std::size_t i = 1; i < n; ++i) {
+      last = last->next;
+    }
+    local.head = last->next;
+    local.cnt -= n;
+    last->next = nullptr;
+    Global& global = global_pool();
+    std::lock_guard<std::mutex> l(global.m);
+    global.batches.emplace_back(Batch{first, n});
+  }
+};
+
+// 可用于标准容器和本仓库节点式容器的分配器，单个对象从 FixedSizePool 分配，
+// 数组仍使用 std::allocator。无状态，所有实例都相等
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n == 1) {
+      return static_cast<T*>(Pool::allocate());
+    }
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    if (n == 1) {
+      Pool::deallocate(p);
+    } else {
+      std::allocator<T>{}.deallocate(p, n);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const noexcept {
+    return false;
+  }
+
+ private:
+  using Pool = FixedSizePool<sizeof(T), alignof(T)>;
+};
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 在 ThreadPool 上运行的并行算法，Pool 为 BasicThreadPool 的任意实例。
+// 区间按 grain 个元素划分为块，线程按下标递增的顺序领取，先完成的线程领取更多，
+// 调用者也参与执行并在等待时执行队列中的任务，因此可以在工作线程中调用。
+// grain 为 0 时使用 default_grain，每块约 ParallelGrainBytes 字节。
+// 传入的函数对象被所有线程共享，必须可以并发调用
+
+// L1 数据缓存的一半，处理一块期间它的数据留在缓存中，块数又足够在线程间均衡负载
+constexpr std::size_t ParallelGrainBytes = 16 * 1024;
+
+template <typename RandomIt>
+constexpr std::size_t default_grain() {
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  return std::max<std::size_t>(1, ParallelGrainBytes / sizeof(T));
+}
+
+// 并发执行 body(0) 到 body(chunks - 1)。body 抛出异常时不再领取新块，
+// 等所有已开始的块结束后重新抛出第一个异常
+template <typename Pool, typename Body>
+void parallel_for_chunks(Pool& pool, std::size_t chunks, Body&& body) {
+  if (chunks == 0) {
+    return;
+  }
+  struct State {
+    std::atomic<std::size_t> next = 0;
+    std::atomic<std::size_t> running = 0;  // 已提交、尚未结束的辅助任务
+    std::atomic<bool> failed = false;
+    std::mutex m;
+    std::exception_ptr error;
+  };
+  State s;
+  auto run = [&] {
+    try {
+      for (std::size_t i; !s.failed.load(std::memory_order_relaxed) &&
+                          (i = s.next.fetch_add(1, std::memory_order_relaxed)) <
+                              chunks;) {
+        body(i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> l(s.m);
+      if (!s.error) {
+        s.error = std::current_exception();
+      }
+      s.failed.store(true, std::memory_order_relaxed);
+    }
+  };
+  const std::size_t helpers = std::min(chunks - 1, pool.size());
+  for (std::size_t i = 0; i < helpers; ++i) {
+    s.running.fetch_add(1, std::memory_order_relaxed);
+    try {
+      pool.post([&] {
+        run();
+        s.running.fetch_sub(1, std::memory_order_release);
+      });
+    } catch (...) {  // 如线程池已关闭，剩下的块由调用者执行
+      s.running.fetch_sub(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+  run();
+  while (s.running.load(std::memory_order_acquire) != 0) {
+    pool.run_pending_task();
+  }
+  if (s.error) {
+    std::rethrow_exception(s.error);
+  }
+}
+
+template <typename T, typename RandomIt, std::size_t... I>
+std::array<T, sizeof...(I)> load_lanes(RandomIt first,
+                                       std::index_sequence<I...>) {
+  return {{T(first[I])...}};
+}
+
+// 顺序归约 init 与 [first, last)。Lanes 个独立的累加器打破了相邻两次 op 之间
+// 的依赖，编译器可以把内层循环向量化。与 std::reduce 一样要求 op 满足结合律
+// 和交换律，浮点数的结果与按顺序累加只差舍入误差
+template <std::size_t Lanes = 8, typename RandomIt, typename T, typename Op>
+T unrolled_reduce(RandomIt first, RandomIt last, T init, Op op) {
+  if (static_cast<std::size_t>(last - first) >= Lanes) {
+    auto acc = load_lanes<T>(first, std::make_index_sequence<Lanes>());
+    first += Lanes;
+    for (; static_cast<std::size_t>(last - first) >= Lanes; first += Lanes) {
+      for (std::size_t j = 0; j < Lanes; ++j) {
+        acc[j] = op(std::move(acc[j]), first[j]);
+      }
+    }
+    for (std::size_t j = 0; j < Lanes; ++j) {
+      init = op(std::move(init), std::move(acc[j]));
+    }
+  }
+  for (; first != last; ++first) {
+    init = op(std::move(init), *first);
+  }
+  return init;
+}
+
+template <typename Pool, typename RandomIt, typename F>
+void parallel_for_each(Pool& pool, RandomIt first, RandomIt last, F f,
+                       std::size_t grain = 0) {
+  const auto n = static_cast<std::size_t>(last - first);
+  grain = grain ? grain : default_grain<RandomIt>();
+  parallel_for_chunks(pool, (n + grain - 1) / grain, [&](std::size_t i) {
+    const std::size_t b = i * grain;
+    std::for_each(first + b, first + std::min(n, b + grain), std::ref(f));
+  });
+}
+
+// 每块用 unrolled_reduce 归约，再按块的顺序与 init 合并
+template <typename Pool, typename RandomIt, typename T,
+          typename Op = std::plus<>>
+T parallel_reduce(Pool& pool, RandomIt first, RandomIt last, T init,
+                  Op op = Op{}, std::size_t grain = 0) {
+  const auto n = static_cast<std::size_t>(last - first);
+  grain = grain ? grain : default_grain<RandomIt>();
+  const std::size_t chunks = (n + grain - 1) / grain;
+  std::vector<std::optional<T>> partial(chunks);
+  parallel_for_chunks(pool, chunks, [&](std::size_t i) {
+    const RandomIt b = first + i * grain;
+    const RandomIt e = first + std::min(n, i * grain + grain);
+    partial[i].emplace(unrolled_reduce(b + 1, e, T(*b), op));
+  });
+  for (std::optional<T>& x : partial) {
+    init = op(std::move(init), std::move(*x));
+  }
+  return init;
+}
+
+// 与 std::partial_sum 相同，d_first 可以等于 first。
+// 先并行地按顺序累加每块得到块的总和，顺序求出每块之前所有元素的和，
+// 再并行地从这个偏移开始计算每块的前缀和，每个元素读两次、写一次。
+// op 只需满足结合律，因此块的总和不用 unrolled_reduce，它会改变运算顺序
+template <typename Pool, typename RandomIt, typename OutputIt,
+          typename Op = std::plus<>>
+OutputIt parallel_partial_sum(Pool& pool, RandomIt first, RandomIt last,
+                              OutputIt d_first, Op op = Op{},
+                              std::size_t grain = 0) {
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  const auto n = static_cast<std::size_t>(last - first);
+  grain = grain ? grain : default_grain<RandomIt>();
+  const std::size_t chunks = (n + grain - 1) / grain;
+  if (chunks <= 1) {
+    return std::partial_sum(first, last, d_first, op);
+  }
+  std::vector<std::optional<T>> offset(chunks);  // 块 i 之前所有元素的和
+  parallel_for_chunks(pool, chunks - 1, [&](std::size_t i) {
+    const RandomIt b = first + i * grain;
+    offset[i + 1].emplace(std::accumulate(b + 1, b + grain, T(*b), op));
+  });
+  for (std::size_t i = 2; i < chunks; ++i) {
+    *offset[i] = op(*offset[i - 1], std::move(*offset[i]));
+  }
+  parallel_for_chunks(pool, chunks, [&](std::size_t i) {
+    const RandomIt b = first + i * grain;
+    const RandomIt e = first + std::min(n, i * grain + grain);
+    OutputIt out = d_first + i * grain;
+    if (i == 0) {
+      std::partial_sum(b, e, out, op);
+      return;
+    }
+    T acc = op(*offset[i], *b);
+    *out = acc;
+    for (RandomIt it = b + 1; it != e; ++it) {
+      acc = op(std::move(acc), *it);
+      *++out = acc;
+    }
+  });
+  return d_first + n;
+}
+
+// 返回第一个满足 pred 的元素，与 std::find_if 相同。
+// 块按顺序领取，找到后之后领取的块都在更后面，直接跳过
+template <typename Pool, typename RandomIt, typename Pred>
+RandomIt parallel_find_if(Pool& pool, RandomIt first, RandomIt last,
+                          Pred pred, std::size_t grain = 0) {
+  const auto n = static_cast<std::size_t>(last - first);
+  grain = grain ? grain : default_grain<RandomIt>();
+  std::atomic<std::size_t> found = n;
+  parallel_for_chunks(pool, (n + grain - 1) / grain, [&](std::size_t i) {
+    const std::size_t b = i * grain;
+    if (found.load(std::memory_order_relaxed) < b) {
+      return;
+    }
+    const RandomIt e = first + std::min(n, b + grain);
+    const RandomIt it = std::find_if(first + b, e, std::ref(pred));
+    if (it == e) {
+      return;
+    }
+    const auto pos = static_cast<std::size_t>(it - first);
+    std::size_t cur = found.load(std::memory_order_relaxed);
+    while (pos < cur &&
+           !found.compare_exchange_weak(cur, pos, std::memory_order_relaxed)) {
+    }
+  });
+  return first + found.load(std::memory_order_relaxed);
+}
+
+template <typename Pool, typename RandomIt, typename T>
+RandomIt parallel_find(Pool& pool, RandomIt first, RandomIt last,
+                       const T& value, std::size_t grain = 0) {
+  return parallel_find_if(
+      pool, first, last, [&](const auto& x) { return x == value; }, grain);
+}
+
+// 并行快速排序。每次划分后把一半作为任务提交，在工作线程中提交时进入该线程
+// 的本地队列，由空闲线程窃取，继续划分另一半。小于 grain 的区间或划分层数
+// 超过 2 log n 时（枢轴总是选得很差）改用 std::sort
+template <typename Pool, typename RandomIt, typename Compare>
+class ParallelSorter {
+ public:
+  ParallelSorter(Pool& pool, Compare comp, std::size_t grain)
+      : pool_(pool), comp_(std::move(comp)), grain_(std::max<std::size_t>(
+                                                  grain, 2)) {}
+
+  ParallelSorter(const ParallelSorter&) = delete;
+
+  ParallelSorter& operator=(const ParallelSorter&) = delete;
+
+  void sort(RandomIt first, RandomIt last) {
+    std::size_t depth = 0;
+    for (auto n = last - first; n > 1; n >>= 1) {
+      depth += 2;
+    }
+    run(first, last, depth);
+    while (pending_.load(std::memory_order_acquire) != 0) {
+      pool_.run_pending_task();
+    }
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  void run(RandomIt first, RandomIt last, std::size_t depth) {
+    try {
+      while (static_cast<std::size_t>(last - first) > grain_) {
+        if (failed_.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (depth-- == 0) {
+          break;
+        }
+        auto [mid1, mid2] = partition(first, last);
+        // 较大的一半交给其他线程，窃取者一次拿到更多的工作
+        if (mid1 - first > last - mid2) {
+          spawn(first, mid1, depth);
+          first = mid2;
+        } else {
+          spawn(mid2, last, depth);
+          last = mid1;
+        }
+      }
+      std::sort(first, last, comp_);
+    } catch (...) {
+      std::lock_guard<std::mutex> l(m_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+      failed_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  void spawn(RandomIt first, RandomIt last, std::size_t depth) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    try {
+      pool_.post([this, first, last, depth] {
+        run(first, last, depth);
+        pending_.fetch_sub(1, std::memory_order_release);
+      });
+    } catch (...) {  // 无法提交时在当前线程排序
+      pending_.fetch_sub(1, std::memory_order_relaxed);
+      run(first, last, depth);
+    }
+  }
+
+  // 三数取中作为枢轴，三路划分为小于、等于、大于枢轴的三段，
+  // 返回等于枢轴的一段 [mid1, mid2)，大量重复元素时不会退化
+  std::pair<RandomIt, RandomIt> partition(RandomIt first, RandomIt last) {
+    const RandomIt mid = first + (last - first) / 2;
+    const RandomIt back = last - 1;
+    if (comp_(*mid, *first)) {
+      std::iter_swap(mid, first);
+    }
+    if (comp_(*back, *mid)) {
+      std::iter_swap(back, mid);
+      if (comp_(*mid, *first)) {
+        std::iter_swap(mid, first);
+      }
+    }
+    std::iter_swap(first, mid);  // 枢轴放在开头，不参与划分，不必复制
+    const RandomIt less_end = std::partition(
+        first + 1, last, [&](const auto& x) { return comp_(x, *first); });
+    const RandomIt pivot = less_end - 1;
+    std::iter_swap(first, pivot);
+    const RandomIt equal_end = std::partition(
+        less_end, last, [&](const auto& x) { return !comp_(*pivot, x); });
+    return {pivot, equal_end};
+  }
+
+ private:
+  Pool& pool_;
+  Compare comp_;
+  const std::size_t grain_;
+  std::atomic<std::size_t> pending_ = 0;  // 已提交、尚未结束的任务
+  std::atomic<bool> failed_ = false;
+  std::mutex m_;
+  std::exception_ptr error_;
+};
+
+template <typename Pool, typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(Pool& pool, RandomIt first, RandomIt last,
+                   Compare comp = Compare{}, std::size_t grain = 0) {
+  ParallelSorter<Pool, RandomIt, Compare> sorter(
+      pool, std::move(comp), grain ? grain : default_grain<RandomIt>());
+  sorter.sort(first, last);
+}
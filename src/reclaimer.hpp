@@ -0,0 +1,23 @@
+#pragma once
+
+#include "epoch_reclaimer.hpp"
+#include "hazard_pointer.hpp"
+
+// 无锁容器用模板参数 Reclaimer 选择节点回收方式，Reclaimer 需要提供：
+//
+//   class Reclaimer::Guard {  // 不可复制，在一次操作期间存在于栈上
+//     // 读取 src，返回的对象在 Guard 析构或 reset 之前不会被释放
+//     template <typename U> U* protect(const std::atomic<U*>& src);
+//     void reset();  // 不再访问 protect 返回的对象
+//   };
+//   // p 已从数据结构中摘除，之后不会再被新的 protect 读到，
+//   // 在所有可能引用它的 Guard 结束后调用 deleter(p)
+//   static void Reclaimer::retire(void* p, void (*deleter)(void*));
+//   // 为 true 时 Guard 保护整个作用域内读到的所有对象，
+//   // 可以沿链表连续前进而无需逐个 protect
+//   static constexpr bool ProtectsScope;
+//
+// HazardPointerReclaimer 的每个 Guard 只保护一个指针，内存占用有上界，
+// 但每次 protect 都要写风险指针并重读。
+// EpochReclaimer 的 Guard 保护整个临界区，protect 只是一次 acquire 读，
+// 适合读多写少、需要连续访问多个节点的遍历，代价是释放可能被延迟
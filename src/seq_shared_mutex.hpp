@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+
+// 带序号的读写锁，可直接用于 std::unique_lock 和 std::shared_lock。
+// 每次独占加锁后序号加 1，解锁前再加 1，序号为奇数表示正在写。
+// 读者可以不加锁，先用 read_begin 取得一个偶数序号，读完后用 read_validate
+// 检验期间没有写者，失败则丢弃读到的数据重试或改为加共享锁（即 seqlock）。
+// 无锁读取的数据可能与写者并发修改，只应用于可平凡复制的数据
+class SeqSharedMutex {
+ public:
+  void lock() {
+    m_.lock();
+    begin_write();
+  }
+
+  bool try_lock() {
+    if (!m_.try_lock()) {
+      return false;
+    }
+    begin_write();
+    return true;
+  }
+
+  void unlock() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+    m_.unlock();
+  }
+
+  void lock_shared() { m_.lock_shared(); }
+
+  bool try_lock_shared() { return m_.try_lock_shared(); }
+
+  void unlock_shared() { m_.unlock_shared(); }
+
+  // 返回奇数时有写者正在修改，不应继续读取
+  std::uint32_t read_begin() const {
+    return seq_.load(std::memory_order_acquire);
+  }
+
+  bool read_validate(std::uint32_t seq) const {
+    // 保证之前的读取都先于下面对序号的读取
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) == seq;
+  }
+
+ private:
+  void begin_write() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+    // 保证序号变为奇数先于之后对数据的修改
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+ private:
+  std::shared_mutex m_;
+  std::atomic<std::uint32_t> seq_ = 0;
+};
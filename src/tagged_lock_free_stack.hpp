@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// 不依赖双字 CAS 的无锁栈。头指针与一个版本号打包在一个 64 位整数中，
+// 每次修改都递增版本号，节点被弹出又压回时 CAS 会因版本号不同而失败，
+// 以此避免 ABA。
+// 64 位平台上用户空间地址只用低 48 位，剩余 16 位存放版本号，
+// 32 位平台上指针和版本号各占 32 位。新分配的节点不满足时 push 抛出异常。
+// 节点来自按类型划分的池，只会在同一种 Node 之间复用，程序退出前不释放，
+// 因此弹出时读取已被其他线程取走的节点的 next 是安全的。
+// 每个线程缓存一批空闲节点，稳定状态下 push 不分配内存
+template <typename T>
+class TaggedLockFreeStack {
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "64-bit atomics must be lock-free");
+
+ public:
+  static constexpr bool is_always_lock_free = true;
+
+  TaggedLockFreeStack() = default;
+
+  ~TaggedLockFreeStack() {
+    while (Node* p = head_.pop()) {
+      p->value()->~T();
+      release_node(p);
+    }
+  }
+
+  TaggedLockFreeStack(const TaggedLockFreeStack&) = delete;
+
+  TaggedLockFreeStack& operator=(const TaggedLockFreeStack&) = delete;
+
+  void push(T x) {
+    Node* p = acquire_node();
+    ::new (static_cast<void*>(p->storage)) T(std::move(x));
+    head_.push(p);
+  }
+
+  std::optional<T> try_pop() {
+    Node* p = head_.pop();
+    if (!p) {
+      return std::nullopt;
+    }
+    std::optional<T> res(std::move(*p->value()));
+    p->value()->~T();
+    release_node(p);
+    return res;
+  }
+
+  bool pop(T& res) {
+    Node* p = head_.pop();
+    if (!p) {
+      return false;
+    }
+    res = std::move(*p->value());
+    p->value()->~T();
+    release_node(p);
+    return true;
+  }
+
+  // 与 LockFreeStack 接口一致，但需要为结果分配内存
+  std::shared_ptr<T> pop() {
+    std::optional<T> x = try_pop();
+    return x ? std::make_shared<T>(std::move(*x)) : nullptr;
+  }
+
+  bool empty() const { return head_.empty(); }
+
+ private:
+  struct Node {
+    // 节点可能在被其他线程读取 next 时复用，因此 next 为原子变量
+    std::atomic<Node*> next = nullptr;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  // 带版本号的栈顶，用于元素栈和空闲节点链表
+  class TaggedHead {
+   public:
+    void push(Node* p) { push_chain(p, p); }
+
+    // 把 first 到 last 的一串节点一次压入
+    void push_chain(Node* first, Node* last) {
+      std::uint64_t old = v_.load(std::memory_order_relaxed);
+      do {
+        last->next.store(pointer(old), std::memory_order_relaxed);
+      } while (!v_.compare_exchange_weak(old, pack(first, tag(old) + 1),
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+    }
+
+    Node* pop() {
+      std::uint64_t old = v_.load(std::memory_order_acquire);
+      while (Node* p = pointer(old)) {
+        // p 可能已被其他线程弹出并复用，读到的 next 过期时下面的 CAS 必然失败
+        Node* next = p->next.load(std::memory_order_relaxed);
+        if (v_.compare_exchange_weak(old, pack(next, tag(old) + 1),
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire)) {
+          return p;
+        }
+      }
+      return nullptr;
+    }
+
+    bool empty() const {
+      return pointer(v_.load(std::memory_order_acquire)) == nullptr;
+    }
+
+    // 地址能否与版本号打包。带标签的指针（如 AArch64 TBI/MTE）或
+    // 超过 48 位的地址空间不满足，打包会破坏版本号
+    static bool fits(const void* p) {
+      const auto bits =
+          static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p));
+      return (bits & ~PointerMask) == 0;
+    }
+
+   private:
+#if UINTPTR_MAX == 0xFFFFFFFF
+    static constexpr int PointerBits = 32;
+#else
+    static constexpr int PointerBits = 48;
+#endif
+    static constexpr std::uint64_t PointerMask =
+        (std::uint64_t{1} << PointerBits) - 1;
+
+    // 所有节点在分配时已由 fits 检查
+    static std::uint64_t pack(Node* p, std::uint64_t tag) {
+      assert(fits(p));
+      return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p)) |
+             (tag << PointerBits);
+    }
+
+    static Node* pointer(std::uint64_t v) {
+      return reinterpret_cast<Node*>(
+          static_cast<std::uintptr_t>(v & PointerMask));
+    }
+
+    static std::uint64_t tag(std::uint64_t v) { return v >> PointerBits; }
+
+   private:
+    std::atomic<std::uint64_t> v_ = 0;
+  };
+
+  static constexpr std::size_t BatchSize = 64;
+
+  // 所有 TaggedLockFreeStack<T> 共享的空闲节点
+  struct Pool {
+    TaggedHead free_list;
+    std::mutex m;
+    std::vector<std::unique_ptr<Node[]>> chunks;  // 保护于 m
+  };
+
+  struct Cache {
+    Node* head = nullptr;
+    std::size_t cnt = 0;
+
+    ~Cache() {  // 线程退出时归还所有节点
+      if (head) {
+        give_back(*this, cnt);
+      }
+    }
+  };
+
+  // 线程局部对象都先于静态对象析构，因此 Cache 析构时 Pool 仍然有效
+  static Pool& pool() {
+    static Pool res;
+    return res;
+  }
+
+  static Cache& cache() {
+    static thread_local Cache res;
+    return res;
+  }
+
+  static Node* acquire_node() {
+    Cache& c = cache();
+    if (!c.head) {
+      refill(c);
+    }
+    Node* p = c.head;
+    c.head = p->next.load(std::memory_order_relaxed);
+    --c.cnt;
+    return p;
+  }
+
+  static void release_node(Node* p) {
+    Cache& c = cache();
+    p->next.store(c.head, std::memory_order_relaxed);
+    c.head = p;
+    if (++c.cnt >= 2 * BatchSize) {  // 保留一批，避免在阈值附近反复归还
+      give_back(c, BatchSize);
+    }
+  }
+
+  // 从全局空闲链表逐个取回至多一批节点，每个节点一次 CAS，为空时新分配一批
+  static void refill(Cache& c) {
+    Pool& p = pool();
+    while (c.cnt < BatchSize) {
+      Node* n = p.free_list.pop();
+      if (!n) {
+        break;
+      }
+      n->next.store(c.head, std::memory_order_relaxed);
+      c.head = n;
+      ++c.cnt;
+    }
+    if (c.head) {
+      return;
+    }
+    std::unique_ptr<Node[]> chunk(new Node[BatchSize]);
+    // 节点地址连续，检查首尾两个即可。发布版本中同样检查
+    if (!TaggedHead::fits(&chunk[0]) ||
+        !TaggedHead::fits(&chunk[BatchSize - 1])) {
+      throw std::runtime_error(
+          "TaggedLockFreeStack: node address does not fit in the tagged head");
+    }
+    Node* nodes = chunk.get();
+    {
+      // 先登记再放入缓存，emplace_back 抛异常时 chunk 被释放，缓存仍为空
+      std::lock_guard<std::mutex> l(p.m);
+      p.chunks.emplace_back(std::move(chunk));
+    }
+    for (std::size_t i = 0; i < BatchSize; ++i) {
+      nodes[i].next.store(c.head, std::memory_order_relaxed);
+      c.head = &nodes[i];
+    }
+    c.cnt = BatchSize;
+  }
+
+  // 从缓存头部摘下 n 个节点，一次 CAS 压入全局空闲链表
+  static void give_back(Cache& c, std::size_t n) {
+    Node* first = c.head;
+    Node* last = first;
+    for (std::size_t i = 1; i < n; ++i) {
+      last = last->next.load(std::memory_order_relaxed);
+    }
+    c.head = last->next.load(std::memory_order_relaxed);
+    c.cnt -= n;
+    pool().free_list.push_chain(first, last);
+  }
+
+ private:
+  TaggedHead head_;
+};
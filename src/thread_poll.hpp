@@ -1,55 +1,619 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <random>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
-class ThreadPool {
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+#include "cpu_relax.hpp"
+#include "cpu_topology.hpp"
+#include "function_wrapper.hpp"
+#include "lock_policy.hpp"
+#include "metrics.hpp"
+#include "work_stealing_queue.hpp"
+
+enum class ThreadAffinity {
+  None,  // 不绑定，由系统调度
+  Core,  // 每个线程绑定到一个 CPU
+  Node,  // 每个线程绑定到所在 NUMA 节点的所有 CPU
+};
+
+struct ThreadPoolOptions {
+  // resize 的上限，实际取值不小于初始线程数和 CPU 核数
+  std::size_t max_threads = 0;
+  // 空闲线程先自旋 spin_cnt 次、再 yield yield_cnt 次，仍无任务才休眠，
+  // 突发到达的任务可以被自旋中的线程直接取走，不必经过内核唤醒
+  std::size_t spin_cnt = 256;
+  std::size_t yield_cnt = 16;
+  // 绑定时线程轮流分配到各 NUMA 节点，
+  // submit_to_node 提交的任务由该节点的线程优先执行
+  ThreadAffinity affinity = ThreadAffinity::None;
+};
+
+// Mutex 保护全局通道，池外线程提交任务和空闲线程休眠时使用，
+// 可以换用 lock_policy.hpp 中的锁，通常直接使用别名 ThreadPool
+template <typename Mutex = std::mutex>
+class BasicThreadPool {
  public:
-  explicit ThreadPool(std::size_t n) {
-    for (std::size_t i = 0; i < n; ++i) {
-      std::thread{[this] {
-        std::unique_lock<std::mutex> l(m_);
-        while (true) {
-          if (!q_.empty()) {
-            auto task = std::move(q_.front());
-            q_.pop();
-            l.unlock();
-            task();
-            l.lock();
-          } else if (done_) {
-            break;
-          } else {
-            cv_.wait(l);
-          }
+  enum class ShutdownMode {
+    Drain,    // 执行完所有已提交的任务再退出
+    Discard,  // 丢弃未开始的任务，对应的 future 得到 broken_promise
+  };
+
+  // 每个优先级对应一个通道，工作线程总是先取高优先级通道的任务，
+  // 批处理任务放入 Low 就不会挡在交互任务前面
+  enum class Priority {
+    High,
+    Normal,
+    Low,
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  struct LaneStats {
+    std::uint64_t submitted = 0;
+    std::uint64_t started = 0;
+    std::uint64_t deadline_missed = 0;  // 开始执行时已超过截止时间的任务数
+    Clock::duration total_wait{};       // 从提交到开始执行的排队时间总和
+    Clock::duration max_wait{};
+  };
+
+  explicit BasicThreadPool(
+      std::size_t n, const ThreadPoolOptions& options = ThreadPoolOptions{})
+      : options_(options) {
+    const std::size_t max_threads =
+        std::max({n, options_.max_threads,
+                  std::size_t{std::thread::hardware_concurrency()}});
+    const CpuTopology topology = CpuTopology::detect();
+    const std::size_t node_cnt = options_.affinity == ThreadAffinity::None
+                                     ? 1
+                                     : topology.node_count();
+    for (std::size_t i = 0; i < node_cnt; ++i) {
+      nodes_.emplace_back(std::make_unique<Node>());
+    }
+    // 所有槽位一次性创建，resize 不会使这些指针失效，窃取时无需加锁
+    for (std::size_t i = 0; i < max_threads; ++i) {
+      auto worker = std::make_unique<Worker>();
+      worker->node = i % node_cnt;
+      const std::vector<int>& cpus = topology.cpus_of_node(worker->node);
+      if (options_.affinity == ThreadAffinity::Core) {
+        worker->cpus.emplace_back(cpus[(i / node_cnt) % cpus.size()]);
+      } else if (options_.affinity == ThreadAffinity::Node) {
+        worker->cpus = cpus;
+      }
+      nodes_[worker->node]->workers.emplace_back(i);
+      workers_.emplace_back(std::move(worker));
+    }
+    try {
+      resize(n);
+    } catch (...) {
+      shutdown(ShutdownMode::Discard);
+      throw;
+    }
+  }
+
+  BasicThreadPool(const BasicThreadPool&) = delete;
+
+  BasicThreadPool& operator=(const BasicThreadPool&) = delete;
+
+  ~BasicThreadPool() { shutdown(ShutdownMode::Drain); }
+
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& f) {
+    return submit(Priority::Normal, Clock::time_point::max(),
+                  std::forward<F>(f));
+  }
+
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(Priority priority,
+                                                            F&& f) {
+    return submit(priority, Clock::time_point::max(), std::forward<F>(f));
+  }
+
+  // 同一通道中带截止时间的任务按截止时间从早到晚执行（EDF），
+  // 且先于该通道中不带截止时间的任务。
+  // std::packaged_task 是 move-only 类型，直接存入 FunctionWrapper，
+  // 不必再用 std::shared_ptr 包裹
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(
+      Priority priority, Clock::time_point deadline, F&& f) {
+    using R = std::invoke_result_t<std::decay_t<F>>;
+    std::packaged_task<R()> task(std::forward<F>(f));
+    std::future<R> res(task.get_future());
+    push_task(std::move(task), priority, deadline);
+    return res;
+  }
+
+  // 不需要结果时使用，省去 std::packaged_task 与 future 共享状态的分配。
+  // f 抛出的异常不会被捕获，会导致程序终止
+  template <typename F>
+  void post(F&& f) {
+    push_task(Task(std::forward<F>(f)), Priority::Normal,
+              Clock::time_point::max());
+  }
+
+#if defined(__cpp_impl_coroutine)
+  // co_await pool.schedule() 挂起当前协程，其余部分作为任务在工作线程中执行，
+  // 在工作线程中以 Normal 优先级调用时进入该线程的本地队列。
+  // 按 Discard 关闭时被丢弃的协程不会恢复，它的协程帧也不会释放
+  auto schedule(Priority priority = Priority::Normal) noexcept {
+    struct Awaiter {
+      BasicThreadPool& pool;
+      Priority priority;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> h) {
+        pool.push_task(Task([h] { h.resume(); }), priority,
+                       Clock::time_point::max());
+      }
+
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{*this, priority};
+  }
+#endif
+
+  // 任务放入 NUMA 节点 node 的队列，该节点的线程先于其他节点的线程执行它，
+  // 使任务靠近它要访问的内存。未绑定节点时只有一个节点
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit_to_node(
+      std::size_t node, F&& f) {
+    using R = std::invoke_result_t<std::decay_t<F>>;
+    std::packaged_task<R()> task(std::forward<F>(f));
+    std::future<R> res(task.get_future());
+    push_task_to_node(std::move(task), node % nodes_.size());
+    return res;
+  }
+
+  // 等待 future 的线程可以循环调用此函数执行队列中的任务，
+  // 避免任务等待子任务时占着工作线程不干活，甚至所有线程都在等待导致死锁
+  void run_pending_task() {
+    QueuedTask task;
+    if (pop_task(task)) {
+      task.f();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  // 调整工作线程数，缩减时被移除的线程会把本地队列中的任务转交给全局队列
+  void resize(std::size_t n) {
+    if (is_worker()) {
+      throw std::logic_error("ThreadPool::resize called from a worker");
+    }
+    if (n > workers_.size()) {
+      throw std::invalid_argument("ThreadPool::resize exceeds max_threads");
+    }
+    std::lock_guard<std::mutex> l(control_m_);
+    if (stopped_) {
+      throw std::runtime_error("ThreadPool is shut down");
+    }
+    const std::size_t cur = thread_cnt_.load();
+    if (n > cur) {
+      thread_cnt_.store(n);
+      for (std::size_t i = cur; i < n; ++i) {
+        workers_[i]->stop.store(false);
+        try {
+          workers_[i]->t =
+              std::thread(&BasicThreadPool::worker_thread, this, i);
+        } catch (...) {
+          stop_workers(i, n);
+          throw;
         }
-      }}.detach();
+      }
+    } else if (n < cur) {
+      stop_workers(n, cur);
     }
   }
 
-  ~ThreadPool() {
+  std::size_t size() const { return thread_cnt_.load(); }
+
+  std::size_t node_count() const { return nodes_.size(); }
+
+  LaneStats lane_stats(Priority priority) const {
+    const Lane& lane = lanes_[static_cast<std::size_t>(priority)];
+    LaneStats res;
+    res.submitted = lane.submitted.load(std::memory_order_relaxed);
+    res.started = lane.started.load(std::memory_order_relaxed);
+    res.deadline_missed = lane.deadline_missed.load(std::memory_order_relaxed);
+    res.total_wait =
+        Clock::duration(lane.total_wait.load(std::memory_order_relaxed));
+    res.max_wait =
+        Clock::duration(lane.max_wait.load(std::memory_order_relaxed));
+    return res;
+  }
+
+  // 不再接受池外提交的任务，按 mode 处理剩余任务后 join 所有线程，可重复调用
+  void shutdown(ShutdownMode mode = ShutdownMode::Drain) {
+    std::lock_guard<std::mutex> control_lock(control_m_);
+    if (stopped_) {
+      return;
+    }
+    std::vector<QueuedTask> discarded;  // 在锁外析构被丢弃的任务
     {
-      std::lock_guard<std::mutex> l(m_);
+      std::lock_guard<Mutex> l(m_);
       done_ = true;  // cv_.wait 使用了 done_ 判断所以要加锁
+      if (mode == ShutdownMode::Discard) {
+        discard_.store(true);
+        for (auto& lane : lanes_) {
+          for (; !lane.fifo.empty(); lane.fifo.pop()) {
+            discarded.emplace_back(std::move(lane.fifo.front()));
+          }
+          std::move(lane.edf.begin(), lane.edf.end(),
+                    std::back_inserter(discarded));
+          lane.edf.clear();
+          lane.size.store(0);
+        }
+        pool_cnt_.store(0);
+      }
     }
     cv_.notify_all();
+    for (std::size_t i = 0; i < thread_cnt_.load(); ++i) {
+      if (workers_[i]->t.joinable()) {
+        workers_[i]->t.join();
+      }
+    }
+    // 线程数为 0 时（构造时或 resize(0) 后）没有线程执行剩余的任务，
+    // 由调用者执行，这些任务不能再提交任务
+    QueuedTask task;
+    while (mode == ShutdownMode::Drain && pop_task(task)) {
+      task.f();
+    }
+    thread_cnt_.store(0);
+    stopped_ = true;
   }
 
-  template <typename F>
-  void submit(F&& f) {
+ private:
+  using Task = FunctionWrapper;
+
+  struct QueuedTask {
+    Task f;
+    Priority priority = Priority::Normal;
+    Clock::time_point enqueue_time;
+    Clock::time_point deadline = Clock::time_point::max();
+    std::uint64_t seq = 0;  // 截止时间相同时按提交顺序执行
+  };
+
+  // 截止时间越早越靠近堆顶
+  struct LaterDeadline {
+    bool operator()(const QueuedTask& lhs, const QueuedTask& rhs) const {
+      return lhs.deadline != rhs.deadline ? lhs.deadline > rhs.deadline
+                                          : lhs.seq > rhs.seq;
+    }
+  };
+
+  // 计数器由多个线程频繁修改，各通道独占缓存行避免伪共享
+  struct alignas(64) Lane {
+    std::queue<QueuedTask> fifo;
+    std::vector<QueuedTask> edf;  // 以 LaterDeadline 组织的堆
+    std::atomic<std::size_t> size = 0;  // 允许不加锁地判断通道是否为空
+    std::atomic<std::uint64_t> submitted = 0;
+    std::atomic<std::uint64_t> started = 0;
+    std::atomic<std::uint64_t> deadline_missed = 0;
+    std::atomic<Clock::rep> total_wait = 0;
+    std::atomic<Clock::rep> max_wait = 0;
+  };
+
+  struct Worker {
+    std::thread t;
+    WorkStealingQueue<QueuedTask> q;
+    std::atomic<bool> stop = false;  // resize 缩减时通知该线程退出
+    std::size_t node = 0;
+    std::vector<int> cpus;  // 为空表示不绑定
+  };
+
+  struct Node {
+    WorkStealingQueue<QueuedTask> q;   // 按 FIFO 顺序取出
+    std::vector<std::size_t> workers;  // 属于该节点的槽位
+  };
+
+  bool is_worker() const { return current_pool_ == this; }
+
+  void push_task(Task f, Priority priority, Clock::time_point deadline) {
+    QueuedTask task{std::move(f), priority, Clock::now(), deadline};
+    Lane& lane = lanes_[static_cast<std::size_t>(priority)];
+    // 池内线程提交的普通任务放入本线程的队列，不竞争 m_
+    if (is_worker() && priority == Priority::Normal &&
+        deadline == Clock::time_point::max()) {
+      lane.submitted.fetch_add(1, std::memory_order_relaxed);
+      workers_[index_]->q.push(std::move(task));
+      local_cnt_.fetch_add(1);
+      notify_idle_worker();
+      return;
+    }
     {
-      std::lock_guard<std::mutex> l(m_);
-      q_.emplace(std::forward<F>(f));
+      std::lock_guard<Mutex> l(m_);
+      if (done_ && !is_worker()) {
+        throw std::runtime_error("submit on a shut down ThreadPool");
+      }
+      lane.submitted.fetch_add(1, std::memory_order_relaxed);
+      push_to_lane(lane, std::move(task));
     }
     cv_.notify_one();
   }
 
+  void push_task_to_node(Task f, std::size_t node) {
+    QueuedTask task{std::move(f), Priority::Normal, Clock::now()};
+    Lane& lane = lanes_[static_cast<std::size_t>(Priority::Normal)];
+    if (is_worker()) {
+      lane.submitted.fetch_add(1, std::memory_order_relaxed);
+      nodes_[node]->q.push(std::move(task));
+      local_cnt_.fetch_add(1);
+      notify_idle_worker();
+      return;
+    }
+    {
+      std::lock_guard<Mutex> l(m_);
+      if (done_) {
+        throw std::runtime_error("submit on a shut down ThreadPool");
+      }
+      lane.submitted.fetch_add(1, std::memory_order_relaxed);
+      nodes_[node]->q.push(std::move(task));
+      local_cnt_.fetch_add(1);
+    }
+    cv_.notify_one();
+  }
+
+  // 调用者持有 m_
+  void push_to_lane(Lane& lane, QueuedTask task) {
+    task.seq = seq_++;
+    if (task.deadline == Clock::time_point::max()) {
+      lane.fifo.emplace(std::move(task));
+    } else {
+      lane.edf.emplace_back(std::move(task));
+      std::push_heap(lane.edf.begin(), lane.edf.end(), LaterDeadline{});
+    }
+    lane.size.fetch_add(1);
+    pool_cnt_.fetch_add(1);
+  }
+
+  // 高优先级通道先于本地队列，低优先级通道排在窃取之后
+  bool pop_task(QueuedTask& task) {
+    if (pop_task_from_lane(Priority::High, task) ||
+        pop_task_from_local_queue(task) || pop_task_from_node_queue(task) ||
+        pop_task_from_lane(Priority::Normal, task) ||
+        pop_task_from_other_thread_queue(task) ||
+        pop_task_from_lane(Priority::Low, task)) {
+      record_start(task);
+      return true;
+    }
+    return false;
+  }
+
+  bool pop_task_from_local_queue(QueuedTask& task) {
+    // 自旋时 local_cnt_ 为 0 则不必给本地队列加锁
+    if (is_worker() && local_cnt_.load(std::memory_order_relaxed) > 0 &&
+        workers_[index_]->q.try_pop(task)) {
+      local_cnt_.fetch_sub(1);
+      return true;
+    }
+    return false;
+  }
+
+  bool pop_task_from_node_queue(QueuedTask& task) {
+    if (is_worker() && local_cnt_.load(std::memory_order_relaxed) > 0 &&
+        nodes_[workers_[index_]->node]->q.try_steal(task)) {
+      local_cnt_.fetch_sub(1);
+      return true;
+    }
+    return false;
+  }
+
+  bool pop_task_from_lane(Priority priority, QueuedTask& task) {
+    Lane& lane = lanes_[static_cast<std::size_t>(priority)];
+    if (lane.size.load(std::memory_order_relaxed) == 0) {
+      return false;  // 自旋时不反复争用 m_
+    }
+    std::lock_guard<Mutex> l(m_);
+    if (!lane.edf.empty()) {
+      std::pop_heap(lane.edf.begin(), lane.edf.end(), LaterDeadline{});
+      task = std::move(lane.edf.back());
+      lane.edf.pop_back();
+    } else if (!lane.fifo.empty()) {
+      task = std::move(lane.fifo.front());
+      lane.fifo.pop();
+    } else {
+      return false;
+    }
+    lane.size.fetch_sub(1);
+    pool_cnt_.fetch_sub(1);
+    return true;
+  }
+
+  // 先窃取同一节点的线程，再依次窃取其他节点的队列和线程
+  bool pop_task_from_other_thread_queue(QueuedTask& task) {
+    if (local_cnt_.load(std::memory_order_relaxed) == 0) {
+      return false;  // 所有本地队列都为空，无需逐个加锁
+    }
+    const std::size_t n = thread_cnt_.load(std::memory_order_relaxed);
+    const std::size_t self_node = is_worker() ? workers_[index_]->node : 0;
+    for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      const std::size_t node = (self_node + i) % nodes_.size();
+      if (((i != 0 || !is_worker()) && nodes_[node]->q.try_steal(task)) ||
+          steal_from_node(node, n, task)) {
+        local_cnt_.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool steal_from_node(std::size_t node, std::size_t thread_cnt,
+                       QueuedTask& task) {
+    const std::vector<std::size_t>& victims = nodes_[node]->workers;
+    if (victims.empty()) {
+      return false;
+    }
+    // 随机选择起点，避免所有线程窃取同一个队列
+    const std::size_t start = rng_() % victims.size();
+    for (std::size_t i = 0; i < victims.size(); ++i) {
+      const std::size_t victim = victims[(start + i) % victims.size()];
+      if (victim < thread_cnt && (victim != index_ || !is_worker()) &&
+          workers_[victim]->q.try_steal(task)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void record_start(const QueuedTask& task) {
+    Lane& lane = lanes_[static_cast<std::size_t>(task.priority)];
+    const Clock::time_point now = Clock::now();
+    const Clock::rep wait = (now - task.enqueue_time).count();
+    lane.started.fetch_add(1, std::memory_order_relaxed);
+    lane.total_wait.fetch_add(wait, std::memory_order_relaxed);
+    Clock::rep max_wait = lane.max_wait.load(std::memory_order_relaxed);
+    while (wait > max_wait && !lane.max_wait.compare_exchange_weak(
+                                  max_wait, wait, std::memory_order_relaxed)) {
+    }
+    if (now > task.deadline) {
+      lane.deadline_missed.fetch_add(1, std::memory_order_relaxed);
+    }
+    wait_histogram(task.priority)
+        .record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - task.enqueue_time)
+                .count()));
+  }
+
+  // 每个通道排队时间的分布，所有线程池共享，见 metrics.hpp
+  static Histogram& wait_histogram(Priority priority) {
+    static Histogram res[] = {
+        Histogram("thread_pool_queue_wait_ns", "lane=\"high\""),
+        Histogram("thread_pool_queue_wait_ns", "lane=\"normal\""),
+        Histogram("thread_pool_queue_wait_ns", "lane=\"low\""),
+    };
+    return res[static_cast<std::size_t>(priority)];
+  }
+
+  // 本地队列不经过 m_，但空闲线程在 m_ 上等待，因此有空闲线程时才需要唤醒。
+  // local_cnt_ 与 idle_cnt_ 都是 seq_cst 操作，
+  // 保证提交者看到 idle_cnt_ 增加，或者等待者看到 local_cnt_ 增加
+  void notify_idle_worker() {
+    if (idle_cnt_.load() > 0) {
+      { std::lock_guard<Mutex> l(m_); }  // 确保等待者已进入 cv_.wait
+      cv_.notify_one();
+    }
+  }
+
+  // 调用者持有 control_m_，停止并 join 线程 [first, last)。
+  // resize 启动线程失败时其中一部分从未启动，这些线程不可 join，直接跳过
+  void stop_workers(std::size_t first, std::size_t last) {
+    thread_cnt_.store(first);
+    for (std::size_t i = first; i < last; ++i) {
+      workers_[i]->stop.store(true);
+    }
+    { std::lock_guard<Mutex> l(m_); }
+    cv_.notify_all();
+    for (std::size_t i = first; i < last; ++i) {
+      if (workers_[i]->t.joinable()) {
+        workers_[i]->t.join();
+      }
+    }
+  }
+
+  // 退出的线程把本地队列剩余的任务转交给 Normal 通道，调用者持有 m_
+  void hand_over_local_tasks(Worker& self) {
+    QueuedTask task;
+    while (self.q.try_pop(task)) {
+      local_cnt_.fetch_sub(1);
+      if (!discard_.load()) {
+        push_to_lane(lanes_[static_cast<std::size_t>(Priority::Normal)],
+                     std::move(task));
+      }
+    }
+  }
+
+  void worker_thread(std::size_t index) {
+    current_pool_ = this;
+    index_ = index;
+    rng_.seed(static_cast<unsigned>(index + 1));
+    Worker& self = *workers_[index];
+    if (!self.cpus.empty()) {
+      CpuTopology::pin_this_thread(self.cpus);
+    }
+    std::size_t idle_rounds = 0;
+    while (true) {
+      if (self.stop.load(std::memory_order_relaxed)) {
+        {
+          std::lock_guard<Mutex> l(m_);
+          hand_over_local_tasks(self);
+        }
+        cv_.notify_all();
+        break;
+      }
+      QueuedTask task;
+      if (pop_task(task)) {
+        if (!discard_.load(std::memory_order_relaxed)) {
+          task.f();
+        }
+        idle_rounds = 0;
+        continue;
+      }
+      if (idle_rounds < options_.spin_cnt + options_.yield_cnt) {
+        if (idle_rounds++ < options_.spin_cnt) {
+          cpu_relax();
+        } else {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      idle_rounds = 0;
+      std::unique_lock<Mutex> l(m_);
+      if (done_ && pool_cnt_.load() == 0 && local_cnt_.load() == 0) {
+        break;
+      }
+      idle_cnt_.fetch_add(1);
+      cv_.wait(l, [&] {
+        return done_ || self.stop.load() || pool_cnt_.load() > 0 ||
+               local_cnt_.load() > 0;
+      });
+      idle_cnt_.fetch_sub(1);
+    }
+    current_pool_ = nullptr;
+  }
+
  private:
-  std::mutex m_;
-  std::condition_variable cv_;
+  const ThreadPoolOptions options_;
+  std::mutex control_m_;  // 串行化 resize 与 shutdown
+  bool stopped_ = false;
+  Mutex m_;
+  ConditionVariableFor<Mutex> cv_;
   bool done_ = false;
-  std::queue<std::function<void()>> q_;
+  std::atomic<bool> discard_ = false;
+  // 池外线程提交的任务和非 Normal 优先级的任务进入全局通道，由 m_ 保护
+  std::array<Lane, 3> lanes_;
+  std::uint64_t seq_ = 0;
+  std::atomic<std::size_t> pool_cnt_ = 0;  // 所有通道的任务总数
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::size_t> thread_cnt_ = 0;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::atomic<std::size_t> local_cnt_ = 0;  // 本地队列与节点队列的任务总数
+  std::atomic<std::size_t> idle_cnt_ = 0;   // 在 cv_ 上等待的线程数
+
+  // 用所属线程池判断是否为池内线程，避免一个池的线程向另一个池提交时用错队列
+  inline static thread_local BasicThreadPool* current_pool_ = nullptr;
+  inline static thread_local std::size_t index_ = 0;
+  inline static thread_local std::minstd_rand rng_;
 };
+
+using ThreadPool = BasicThreadPool<>;
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "bit_ops.hpp"
+
+// 分层时间轮，所有定时器由一个后台线程触发。
+// 共 Levels 层，每层 Slots 个槽，第 l 层的一个槽跨越 Slots^l 个 tick，
+// 定时器按到期 tick 与当前 tick 最高的不同位所在层放入对应的槽，
+// 当前 tick 进位到某层时把该层当前槽中的定时器重新放入更低的层。
+// 定时器节点由使用者持有，以侵入式双向链表挂在槽上，
+// 调度和取消都是 O(1)，不分配内存。
+// 后台线程只在第 0 层下一个非空槽或下一次级联时醒来，没有定时器时休眠
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  class Timer {
+   public:
+    // callback 在后台线程上执行，不能阻塞太久，否则推迟其他定时器。
+    // 它抛出的异常会终止后台线程所在的进程，因此要求 noexcept
+    Timer(void (*callback)(void*) noexcept, void* arg)
+        : callback_(callback), arg_(arg) {}
+
+    Timer(const Timer&) = delete;
+
+    Timer& operator=(const Timer&) = delete;
+
+    ~Timer() {
+      if (wheel_) {
+        wheel_->cancel(*this);
+      }
+    }
+
+   private:
+    friend class TimerWheel;
+
+    void (*callback_)(void*) noexcept;
+    void* arg_;
+    TimerWheel* wheel_ = nullptr;  // 第一次调度后不再改变
+    Timer* prev_ = nullptr;
+    Timer* next_ = nullptr;
+    Timer** head_ = nullptr;  // 所在链表，未调度时为空
+    std::uint64_t expiry_ = 0;
+  };
+
+  explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1))
+      : tick_(tick), start_(Clock::now()), thread_([this] { run(); }) {}
+
+  // 不在进程退出时析构，Timer 可能属于析构顺序更晚的静态对象
+  static TimerWheel& shared() {
+    static TimerWheel* res = new TimerWheel;
+    return *res;
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // 调用时不能有已调度的定时器
+  ~TimerWheel() {
+    {
+      std::lock_guard<std::mutex> l(m_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  // 在 deadline 之后调用 t 的回调，已调度时改为新的时间。
+  // 精度为一个 tick，回调不会早于 deadline 执行
+  void schedule(Timer& t, Clock::time_point deadline) {
+    bool wake = false;
+    {
+      std::lock_guard<std::mutex> l(m_);
+      t.wheel_ = this;
+      if (t.head_) {
+        unlink(t);
+      }
+      // 向上取整，至少在下一个 tick 触发
+      const Clock::rep ticks =
+          (deadline - start_ + tick_ - Clock::duration(1)) / tick_;
+      t.expiry_ = std::max<std::uint64_t>(
+          now_ + 1, static_cast<std::uint64_t>(std::max<Clock::rep>(0, ticks)));
+      insert(t);
+      wake = t.expiry_ < wake_tick_;
+    }
+    if (wake) {
+      cv_.notify_one();
+    }
+  }
+
+  // 返回 true 表示取消时尚未触发。返回后回调不会再执行，
+  // 回调正在执行时等待它结束，因此不能在 t 自己的回调中取消 t
+  bool cancel(Timer& t) {
+    std::unique_lock<std::mutex> l(m_);
+    if (t.head_) {
+      unlink(t);
+      return true;
+    }
+    fired_.wait(l, [&] { return firing_ != &t; });
+    return false;
+  }
+
+ private:
+  static constexpr std::size_t Levels = 4;
+  static constexpr std::size_t SlotBits = 6;
+  static constexpr std::size_t Slots = 1 << SlotBits;
+  static constexpr std::uint64_t SlotMask = Slots - 1;
+  static constexpr std::uint64_t Never =
+      std::numeric_limits<std::uint64_t>::max();
+
+  // 以下函数的调用者持有 m_
+  void insert(Timer& t) {
+    const std::uint64_t diff = t.expiry_ ^ now_;
+    std::size_t level = 0;
+    while (level + 1 < Levels && diff >> (SlotBits * (level + 1))) {
+      ++level;
+    }
+    std::uint64_t slot = t.expiry_ >> (SlotBits * level) & SlotMask;
+    if (diff >> (SlotBits * Levels)) {  // 超出范围，放在最后一层最远的槽里
+      slot = ((now_ >> (SlotBits * level)) + SlotMask) & SlotMask;
+    }
+    push(&slots_[level][slot], t);
+    bitmap_[level] |= std::uint64_t{1} << slot;
+    ++count_;
+  }
+
+  void unlink(Timer& t) {
+    if (t.head_ != &due_) {
+      --count_;
+    }
+    if (t.prev_) {
+      t.prev_->next_ = t.next_;
+    } else {
+      *t.head_ = t.next_;
+    }
+    if (t.next_) {
+      t.next_->prev_ = t.prev_;
+    }
+    if (!*t.head_ && t.head_ != &due_) {
+      const std::size_t i = t.head_ - &slots_[0][0];
+      bitmap_[i / Slots] &= ~(std::uint64_t{1} << i % Slots);
+    }
+    t.head_ = nullptr;
+  }
+
+  static void push(Timer** head, Timer& t) {
+    t.head_ = head;
+    t.prev_ = nullptr;
+    t.next_ = *head;
+    if (*head) {
+      (*head)->prev_ = &t;
+    }
+    *head = &t;
+  }
+
+  // 取出整个槽
+  Timer* take(std::size_t level, std::uint64_t slot) {
+    Timer* res = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    bitmap_[level] &= ~(std::uint64_t{1} << slot);
+    for (Timer* t = res; t; t = t->next_) {
+      --count_;
+    }
+    return res;
+  }
+
+  // 第 0 层下一个非空槽或下一次级联的 tick
+  std::uint64_t next_event() const {
+    const std::uint64_t cur = now_ & SlotMask;
+    const std::uint64_t later = cur == SlotMask ? 0 : ~0ULL << (cur + 1);
+    if (const std::uint64_t m = bitmap_[0] & later) {
+      return (now_ & ~SlotMask) + lowest_bit(m);
+    }
+    return (now_ | SlotMask) + 1;
+  }
+
+  // 推进到 tick，到期的定时器放入 due_
+  void advance(std::uint64_t tick) {
+    if (count_ == 0) {
+      now_ = std::max(now_, tick);
+      return;
+    }
+    for (std::uint64_t e; (e = next_event()) <= tick;) {
+      now_ = e;
+      // 从高层到低层级联，移下来的定时器不会落在更高层的当前槽中
+      for (std::size_t level = Levels - 1; level > 0; --level) {
+        if (now_ & ((std::uint64_t{1} << (SlotBits * level)) - 1)) {
+          continue;
+        }
+        Timer* t = take(level, now_ >> (SlotBits * level) & SlotMask);
+        while (t) {
+          Timer* next = t->next_;
+          insert(*t);
+          t = next;
+        }
+      }
+      for (Timer* t = take(0, now_ & SlotMask); t;) {
+        Timer* next = t->next_;
+        push(&due_, *t);
+        t = next;
+      }
+      if (count_ == 0) {
+        now_ = tick;
+        return;
+      }
+    }
+    now_ = tick;
+  }
+
+  std::uint64_t current_tick() const {
+    return static_cast<std::uint64_t>((Clock::now() - start_) / tick_);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> l(m_);
+    while (!stop_) {
+      advance(current_tick());
+      while (Timer* t = due_) {  // 在锁外执行回调，期间可以调度或取消
+        unlink(*t);
+        firing_ = t;
+        l.unlock();
+        t->callback_(t->arg_);
+        l.lock();
+        firing_ = nullptr;
+        fired_.notify_all();
+      }
+      if (count_ == 0) {
+        wake_tick_ = Never;
+        cv_.wait(l);
+      } else {
+        wake_tick_ = next_event();
+        const auto ticks = static_cast<Clock::rep>(wake_tick_);
+        cv_.wait_until(l, start_ + tick_ * ticks);
+      }
+    }
+  }
+
+ private:
+  const Clock::duration tick_;
+  const Clock::time_point start_;
+  std::mutex m_;
+  std::condition_variable cv_;     // 唤醒后台线程
+  std::condition_variable fired_;  // 等待正在执行的回调结束
+  Timer* slots_[Levels][Slots] = {};
+  std::uint64_t bitmap_[Levels] = {};  // 非空的槽
+  Timer* due_ = nullptr;               // 已到期、尚未执行回调的定时器
+  Timer* firing_ = nullptr;            // 正在执行回调的定时器
+  std::size_t count_ = 0;              // 槽中的定时器数，不含 due_
+  std::uint64_t now_ = 0;              // 已处理到的 tick
+  std::uint64_t wake_tick_ = Never;    // 后台线程下次醒来的 tick
+  bool stop_ = false;
+  std::thread thread_;  // 最后初始化
+};
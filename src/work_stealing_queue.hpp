@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// 每个工作线程独占一个队列，本线程从头部存取（后进先出，缓存更热），
+// 其他线程从尾部窃取，两端分离可以减少与所有者的竞争
+template <typename T>
+class WorkStealingQueue {
+ public:
+  WorkStealingQueue() = default;
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+
+  WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+  void push(T x) {
+    std::lock_guard<std::mutex> l(m_);
+    q_.push_front(std::move(x));
+  }
+
+  bool empty() const {
+    std::lock_guard<std::mutex> l(m_);
+    return q_.empty();
+  }
+
+  bool try_pop(T& res) {
+    std::lock_guard<std::mutex> l(m_);
+    if (q_.empty()) {
+      return false;
+    }
+    res = std::move(q_.front());
+    q_.pop_front();
+    return true;
+  }
+
+  bool try_steal(T& res) {
+    std::lock_guard<std::mutex> l(m_);
+    if (q_.empty()) {
+      return false;
+    }
+    res = std::move(q_.back());
+    q_.pop_back();
+    return true;
+  }
+
+ private:
+  std::deque<T> q_;
+  mutable std::mutex m_;
+};